@@ -0,0 +1,56 @@
+#define CJKIT_VERSION 2
+#include <CJKit.h>
+
+const uint32_t RADIO_FREQUENCY = 433000000; // Hz
+
+CJKit::StreamedRadio<> radio;
+
+// transmit at most 10% of each hour
+CJKit::AirtimeBudget airtime(3600000UL, 0.1f);
+
+// sample credit for the decimation
+float telemetryCredit = 0;
+
+// this will be run once at startup
+void setup() {
+  Serial.begin(9600);
+
+#if CJKIT_VERSION == 2
+  // v2 kit's level shifter requires a slower SPI bus (still way faster than
+  // anything we would transmit).
+  SPI.setClockDivider(SPI_CLOCK_DIV16);
+#endif
+
+  if (radio.begin()) {
+    radio.setFrequency(RADIO_FREQUENCY);
+    Serial.println("radio: init OK");
+  } else {
+    Serial.println("radio: init FAIL");
+  }
+
+  // the radio accounts for each packet and refuses to go over the budget
+  radio.setAirtimeBudget(&airtime);
+}
+
+// this will be run repeatedly after setup
+void loop() {
+  unsigned long now = millis();
+
+  // send fewer samples when we are transmitting too much
+  if (airtime.keepSample(telemetryCredit, now)) {
+    radio.print("t=");
+    radio.print(now);
+    radio.print(" decimation=");
+    radio.println(airtime.decimation());
+    radio.flush();
+  }
+
+  Serial.print("airtime used: ");
+  Serial.print(airtime.usedUs());
+  Serial.print("/");
+  Serial.print(airtime.budgetUs());
+  Serial.print("us, packets dropped: ");
+  Serial.println(radio.packetsThrottled());
+
+  CJKit::xdelay(100); // pause for 0.1s
+}
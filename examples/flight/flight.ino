@@ -0,0 +1,54 @@
+#define CJKIT_VERSION 2
+#include <CJKit.h>
+
+CJKit::Pressure pressure;
+CJKit::FlightPhaseDetector flight;
+
+// called by the detector as soon as an event is detected
+void onFlightEvent(CJKit::FlightEvent event, unsigned long timeMs) {
+  switch (event) {
+  case CJKit::FlightEvent::LAUNCH:
+    Serial.print("launch at ");
+    break;
+  case CJKit::FlightEvent::APOGEE:
+    digitalWrite(CJKit::BUZZER_PIN, HIGH); // start beeping for recovery
+    Serial.print("apogee at ");
+    break;
+  case CJKit::FlightEvent::LANDING:
+    Serial.print("landing at ");
+    break;
+  }
+  Serial.print(timeMs);
+  Serial.println("ms");
+}
+
+// feed the detector while waiting in xdelay, not just once per loop
+void sampleFlight(uint32_t) {
+  flight.addPressureSample(pressure.readPressurePa(), millis());
+}
+
+// this will be run once at startup
+void setup() {
+  Serial.begin(9600);
+  pinMode(CJKit::BUZZER_PIN, OUTPUT);
+
+  if (!pressure.begin()) {
+    Serial.println("pressure: FAIL: begin");
+  }
+
+  flight.setEventCallback(CJKit::FlightEvent::LAUNCH, onFlightEvent);
+  flight.setEventCallback(CJKit::FlightEvent::APOGEE, onFlightEvent);
+  flight.setEventCallback(CJKit::FlightEvent::LANDING, onFlightEvent);
+  CJKit::setXdelayIdleTask(sampleFlight);
+}
+
+// this will be run repeatedly after setup
+void loop() {
+  sampleFlight(0);
+
+  Serial.print("height=");
+  Serial.print(flight.heightM());
+  Serial.println("m");
+
+  CJKit::xdelay(1000); // keeps sampling while paused
+}
@@ -0,0 +1,69 @@
+#define CJKIT_VERSION 2
+#include <CJKit.h>
+
+const uint32_t RADIO_FREQUENCY = 433000000; // Hz
+
+// set to false when programming the ground station
+const bool IS_CANSAT = true;
+
+// the CanSat is node 0 and the ground station node 1
+CJKit::StreamedRadio<IS_CANSAT ? 0 : 1, IS_CANSAT ? 1 : 0> radio;
+
+// called by the ground station for every complete message
+void onMessage(uint8_t const *message, size_t len) {
+  Serial.write(message, len);
+  Serial.println();
+}
+
+// rebuilds messages of up to 200 bytes from received packets
+CJKit::MessageReassembler<200> reassembler(onMessage);
+
+// this will be run once at startup
+void setup() {
+  Serial.begin(9600);
+
+#if CJKIT_VERSION == 2
+  // v2 kit's level shifter requires a slower SPI bus (still way faster than
+  // anything we would transmit).
+  SPI.setClockDivider(SPI_CLOCK_DIV16);
+#endif
+
+  if (radio.begin()) {
+    radio.setFrequency(RADIO_FREQUENCY);
+    Serial.println("radio: init OK");
+  } else {
+    Serial.println("radio: init FAIL");
+  }
+}
+
+// this will be run repeatedly after setup
+void loop() {
+  if (!IS_CANSAT) {
+    uint8_t packet[CJKit::RADIO_PAYLOAD_MAX_SIZE];
+    uint8_t len = radio.receive(packet, sizeof(packet));
+    if (len > 0) {
+      reassembler.feed(packet, len);
+    }
+    return;
+  }
+
+  // each message arrives whole or not at all, several per packet
+  radio.beginMessage();
+  radio.print("uptime=");
+  radio.print(millis());
+  radio.endMessage();
+
+  radio.beginMessage();
+  radio.print("analog=");
+  radio.print(analogRead(A0));
+  radio.endMessage();
+
+  // messages are sent when a packet fills up: send them out every 5s
+  static unsigned long lastFlush = 0;
+  if (millis() - lastFlush >= 5000) {
+    radio.flush();
+    lastFlush = millis();
+  }
+
+  CJKit::xdelay(1000); // pause for 1s
+}
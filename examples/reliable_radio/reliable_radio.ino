@@ -0,0 +1,69 @@
+#define CJKIT_VERSION 2
+#include <CJKit.h>
+
+const uint32_t RADIO_FREQUENCY = 433000000; // Hz
+
+// set to false when programming the ground station
+const bool IS_CANSAT = true;
+
+// ReliableRadio keeps up to 8 packets until the other node acknowledges them
+// (the CanSat is node 0 and the ground station node 1)
+CJKit::ReliableRadio<IS_CANSAT ? 0 : 1, IS_CANSAT ? 1 : 0, 100, 8> radio;
+
+// process ACKs and retransmissions while waiting in xdelay
+void pollRadio(uint32_t) { radio.poll(); }
+
+// this will be run once at startup
+void setup() {
+  Serial.begin(9600);
+
+#if CJKIT_VERSION == 2
+  // v2 kit's level shifter requires a slower SPI bus (still way faster than
+  // anything we would transmit).
+  SPI.setClockDivider(SPI_CLOCK_DIV16);
+#endif
+
+  if (radio.begin()) {
+    radio.setFrequency(RADIO_FREQUENCY);
+    Serial.println("radio: init OK");
+  } else {
+    Serial.println("radio: init FAIL");
+  }
+
+#if CJKIT_VERSION != 0
+  // lower transmit power while the ground station hears us well
+  radio.setAdaptivePower(true);
+#endif
+
+  CJKit::setXdelayIdleTask(pollRadio);
+}
+
+// this will be run repeatedly after setup
+void loop() {
+  if (!IS_CANSAT) {
+    uint8_t packet[CJKit::RADIO_PAYLOAD_MAX_SIZE];
+    uint8_t len = radio.receive(packet, sizeof(packet));
+    if (len > 0) {
+      Serial.write(packet, len);
+      Serial.println();
+    }
+    return;
+  }
+
+  radio.print("I have been awake for ");
+  radio.print(millis());
+  radio.println("ms.");
+  radio.flush();
+
+  CJKit::RadioLinkStats const &stats = radio.linkStats();
+  Serial.print("sent=");
+  Serial.print(stats.packetsSent);
+  Serial.print(" lost=");
+  Serial.print(stats.packetsLost);
+  Serial.print(" retransmissions=");
+  Serial.print(stats.retransmissions);
+  Serial.print(" rssi=");
+  Serial.println(stats.lastRssiDBm);
+
+  CJKit::xdelay(1000); // pause for 1s
+}
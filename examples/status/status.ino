@@ -0,0 +1,36 @@
+#define CJKIT_VERSION 2
+#include <CJKit.h>
+
+// players for the buzzer and the built-in LED (fast pins: no digitalWrite)
+CJKit::PatternPlayer<CJKit::BuzzerPin> buzzer;
+CJKit::PatternPlayer<CJKit::BuiltinLedPin> led;
+
+// short-short-long beeps (durations in ms, alternating on and off)
+// the idle task runs about every 250ms, so steps are multiples of 250ms
+const uint16_t READY_BEEPS[] = {250, 250, 250, 250, 750, 1250};
+
+// advance the patterns while waiting in xdelay
+void updatePatterns(uint32_t) {
+  buzzer.update();
+  led.update();
+}
+
+// this will be run once at startup
+void setup() {
+  Serial.begin(9600);
+
+  buzzer.begin();
+  led.begin();
+  CJKit::setXdelayIdleTask(updatePatterns);
+
+  buzzer.play(READY_BEEPS, sizeof(READY_BEEPS) / sizeof(READY_BEEPS[0]));
+  led.playCode(2); // blink twice, pause, repeat
+}
+
+// this will be run repeatedly after setup
+void loop() {
+  // the patterns keep playing while the program does its work
+  Serial.println(millis());
+
+  CJKit::xdelay(1000); // pause for 1s
+}
@@ -0,0 +1,227 @@
+// Drives radios with an airtime budget over the fake radio channel (see
+// stubs/RFM69.h), checking the duty cycle and the decimation factor.
+#include "check.h"
+#include <airtime.h>
+#include <radio.h>
+#include <reliable_radio.h>
+
+using namespace CJKit;
+
+static const unsigned long WINDOW_MS = 60000;
+static const float DUTY_CYCLE = 0.1f;
+
+struct Transmission {
+  uint8_t node;
+  unsigned long startUs;
+  uint32_t airtimeUs;
+};
+
+static Transmission transmissions[20000];
+static size_t transmissionCount = 0;
+
+static void logTransmission(uint8_t node, unsigned long startUs,
+                            uint32_t airtimeUs) {
+  CHECK(transmissionCount < sizeof(transmissions) / sizeof(transmissions[0]));
+  transmissions[transmissionCount++] = {node, startUs, airtimeUs};
+}
+
+/// Moves the fake clock forward to timeMs, if it is not there yet.
+static void advanceTo(unsigned long timeMs) {
+  unsigned long nowUs = micros();
+  if (nowUs < timeMs * 1000) {
+    fakeAdvanceUs(timeMs * 1000 - nowUs);
+  }
+}
+
+/// Largest airtime (µs) used by a node in any window of windowMs.
+static uint32_t maxWindowAirtimeUs(uint8_t node, unsigned long windowMs) {
+  uint32_t maxUs = 0;
+  uint32_t sumUs = 0;
+  size_t end = 0;
+  for (size_t i = 0; i < transmissionCount; i++) {
+    if (transmissions[i].node != node) {
+      continue;
+    }
+    unsigned long windowEndUs = transmissions[i].startUs + windowMs * 1000;
+    for (; end < transmissionCount && transmissions[end].startUs < windowEndUs;
+         end++) {
+      if (transmissions[end].node == node) {
+        sumUs += transmissions[end].airtimeUs;
+      }
+    }
+    maxUs = max(maxUs, sumUs);
+    sumUs -= transmissions[i].airtimeUs;
+  }
+  return maxUs;
+}
+
+/// Airtime (µs) used by a node in [fromMs, toMs).
+static uint32_t airtimeBetweenUs(uint8_t node, unsigned long fromMs,
+                                 unsigned long toMs) {
+  uint32_t sumUs = 0;
+  for (size_t i = 0; i < transmissionCount; i++) {
+    Transmission const &t = transmissions[i];
+    if (t.node == node && t.startUs >= fromMs * 1000 &&
+        t.startUs < toMs * 1000) {
+      sumUs += t.airtimeUs;
+    }
+  }
+  return sumUs;
+}
+
+/**
+ * Sends full packets every periodMs through a budgeted StreamedRadio,
+ * decimated with AirtimeBudget::keepSample.
+ *
+ * @param minDecimation - Set to the lowest decimation in the second half.
+ * @param maxDecimation - Set to the highest decimation in the second half.
+ */
+static void sendTelemetry(StreamedRadio<> &radio, AirtimeBudget &airtime,
+                          unsigned long startMs, unsigned long endMs,
+                          unsigned long periodMs, float *minDecimation,
+                          float *maxDecimation) {
+  float credit = 0;
+  *minDecimation = AIRTIME_MAX_DECIMATION;
+  *maxDecimation = 0;
+  for (unsigned long t = startMs; t < endMs; t += periodMs) {
+    advanceTo(t);
+    if (airtime.keepSample(credit, millis())) {
+      uint8_t sample[RADIO_PAYLOAD_MAX_SIZE] = {0};
+      radio.write(sample, sizeof(sample));
+      radio.flush();
+    }
+
+    if (t >= (startMs + endMs) / 2) {
+      *minDecimation = min(*minDecimation, airtime.decimation());
+      *maxDecimation = max(*maxDecimation, airtime.decimation());
+    }
+  }
+}
+
+/// 10Hz of full packets need more than the 10% duty cycle: the decimation
+/// settles and uses most of the budget, without ever going over it.
+static void steadyTelemetry(void) {
+  StreamedRadio<> radio;
+  CHECK(radio.begin());
+  AirtimeBudget airtime(WINDOW_MS, DUTY_CYCLE, millis());
+  radio.setAirtimeBudget(&airtime);
+
+  transmissionCount = 0;
+  unsigned long startMs = millis();
+  unsigned long endMs = startMs + 10 * WINDOW_MS;
+  float minDecimation, maxDecimation;
+  sendTelemetry(radio, airtime, startMs, endMs, 100, &minDecimation,
+                &maxDecimation);
+
+  uint32_t maxUs = maxWindowAirtimeUs(0, WINDOW_MS);
+  uint32_t lastUs = airtimeBetweenUs(0, endMs - WINDOW_MS, endMs);
+  printf("10Hz x 61B: decimation %.3f-%.3f, last window %.1f%% of budget, "
+         "worst window %.1f%%\n",
+         minDecimation, maxDecimation, 100.0 * lastUs / airtime.budgetUs(),
+         100.0 * maxUs / airtime.budgetUs());
+  CHECK(maxUs <= airtime.budgetUs());
+  CHECK(minDecimation > 1 && maxDecimation < minDecimation * 1.1f);
+  CHECK(lastUs >= airtime.budgetUs() * 8 / 10);
+}
+
+/// After a burst, the decimation comes back down once the rate drops, even if
+/// almost nothing is being sent.
+static void burstThenIdle(void) {
+  StreamedRadio<> radio;
+  CHECK(radio.begin());
+  AirtimeBudget airtime(WINDOW_MS, DUTY_CYCLE, millis());
+  radio.setAirtimeBudget(&airtime);
+
+  transmissionCount = 0;
+  unsigned long startMs = millis();
+  float minDecimation, maxDecimation;
+  sendTelemetry(radio, airtime, startMs, startMs + 2 * WINDOW_MS, 20,
+                &minDecimation, &maxDecimation);
+  printf("50Hz burst: decimation %.3f-%.3f\n", minDecimation, maxDecimation);
+  CHECK(minDecimation > 2);
+
+  sendTelemetry(radio, airtime, startMs + 2 * WINDOW_MS,
+                startMs + 4 * WINDOW_MS, 1000, &minDecimation, &maxDecimation);
+  printf("1Hz after burst: decimation %.3f-%.3f\n", minDecimation,
+         maxDecimation);
+  CHECK(maxDecimation == 1);
+  CHECK(maxWindowAirtimeUs(0, WINDOW_MS) <= airtime.budgetUs());
+}
+
+/// Plain packets refused by the budget are dropped, and counted.
+static void plainRefusalsCounted(void) {
+  StreamedRadio<> radio;
+  CHECK(radio.begin());
+
+  // room for 2 full packets every 3s
+  uint32_t packetUs = AirtimeBudget::packetAirtimeUs(RADIO_PAYLOAD_MAX_SIZE);
+  AirtimeBudget airtime(3000, 2.0f * packetUs / 3000000, millis());
+  radio.setAirtimeBudget(&airtime);
+
+  transmissionCount = 0;
+  uint8_t packet[RADIO_PAYLOAD_MAX_SIZE] = {0};
+  for (uint8_t i = 0; i < 5; i++) {
+    radio.write(packet, sizeof(packet));
+    radio.flush();
+  }
+  CHECK(transmissionCount == 2);
+  CHECK(radio.packetsThrottled() == 3);
+}
+
+/// A packet throttled on its first transmission is not counted as sent, and
+/// goes out as soon as the budget allows instead of after a timeout.
+static void reliableThrottledFirstSend(void) {
+  ReliableRadio<0, 1, 100, 4> sender;
+  ReliableRadio<1, 0, 100, 4> receiver;
+  CHECK(sender.begin() && receiver.begin());
+  sender.setRetransmission(1000, 3);
+
+  // room for 2 full packets every 3s
+  uint8_t packet[RADIO_PAYLOAD_MAX_SIZE - RADIO_RELIABLE_HEADER_SIZE] = {0};
+  uint32_t packetUs = AirtimeBudget::packetAirtimeUs(RADIO_PAYLOAD_MAX_SIZE);
+  AirtimeBudget airtime(3000, 2.0f * packetUs / 3000000, millis());
+  sender.setAirtimeBudget(&airtime);
+
+  transmissionCount = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    sender.write(packet, sizeof(packet));
+    sender.flush();
+    receiver.receive(packet, sizeof(packet));
+  }
+  RadioLinkStats const &stats = sender.linkStats();
+  CHECK(stats.packetsSent == 2);
+  CHECK(stats.packetsThrottled == 1);
+
+  unsigned long readyMs = millis() + airtime.nextSlotMs(packetUs, millis());
+  unsigned long sentMs = 0;
+  for (unsigned long t = millis(); t < readyMs + 2000 && sentMs == 0;
+       t += 10) {
+    advanceTo(t);
+    size_t before = transmissionCount;
+    sender.poll();
+    for (size_t i = before; i < transmissionCount; i++) {
+      if (transmissions[i].node == 0) {
+        sentMs = transmissions[i].startUs / 1000;
+      }
+    }
+    receiver.receive(packet, sizeof(packet));
+  }
+
+  printf("throttled packet: budget ready at %lums, sent at %lums\n", readyMs,
+         sentMs);
+  CHECK(sentMs >= readyMs && sentMs <= readyMs + 10);
+  CHECK(stats.packetsSent == 3);
+  CHECK(stats.packetsThrottled == 1);
+  CHECK(sender.packetsThrottled() == 1);
+  CHECK(stats.retransmissions == 0);
+}
+
+int main(void) {
+  fakeRadioSetTransmitHook(logTransmission);
+  steadyTelemetry();
+  burstThenIdle();
+  plainRefusalsCounted();
+  reliableThrottledFirstSend();
+  printf("airtime_sim: OK\n");
+  return 0;
+}
@@ -0,0 +1,16 @@
+#ifndef _CJKIT_TEST_CHECK_H
+#define _CJKIT_TEST_CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Aborts the test with a message if cond is false.
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+      exit(1);                                                                 \
+    }                                                                          \
+  } while (0)
+
+#endif
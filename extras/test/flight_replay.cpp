@@ -0,0 +1,173 @@
+// Replays synthetic flight traces through FlightPhaseDetector and reports the
+// detection latencies.
+#include "check.h"
+#include <flight.h>
+#include <math.h>
+
+using namespace CJKit;
+
+static const double GROUND_PRESSURE_PA = 101325;
+
+/// Deterministic noise in [-amplitude, amplitude].
+static double noise(double amplitude) {
+  static uint32_t state = 12345;
+  state = state * 1103515245 + 12345;
+  return amplitude * (((state >> 16) & 0x7fff) / 16383.5 - 1);
+}
+
+static int32_t pressureAt(double heightM) {
+  return (int32_t)(GROUND_PRESSURE_PA * pow(1 - heightM / 44330, 1 / 0.1903));
+}
+
+/// Rocket flight: 10s on the pad (long enough for the ground reference at
+/// 1Hz), ascent to 300m with apogee at 17s, then parachute descent at 8m/s.
+static double rocketHeightM(double t) {
+  if (t < 10) {
+    return 0;
+  } else if (t < 17) {
+    double u = (17 - t) / 7;
+    return 300 * (1 - u * u);
+  } else {
+    double h = 300 - (t - 17) * 8;
+    return h > 0 ? h : 0;
+  }
+}
+static const double ROCKET_APOGEE_S = 17;
+static const double ROCKET_LANDING_S = 17 + 300.0 / 8;
+
+static unsigned long events[FLIGHT_EVENT_COUNT];
+static int eventCount[FLIGHT_EVENT_COUNT];
+
+static void onEvent(FlightEvent event, unsigned long timeMs) {
+  events[(uint8_t)event] = timeMs;
+  eventCount[(uint8_t)event]++;
+}
+
+static void resetEvents(FlightPhaseDetector &detector) {
+  for (uint8_t i = 0; i < FLIGHT_EVENT_COUNT; i++) {
+    events[i] = 0;
+    eventCount[i] = 0;
+    detector.setEventCallback((FlightEvent)i, onEvent);
+  }
+}
+
+static void checkAllEventsOnce(void) {
+  for (uint8_t i = 0; i < FLIGHT_EVENT_COUNT; i++) {
+    CHECK(eventCount[i] == 1);
+  }
+}
+
+/// Barometer-only replay at the given sample period.
+static void replayPressure(unsigned long periodMs) {
+  FlightPhaseDetector detector;
+  resetEvents(detector);
+
+  for (unsigned long t = 0; t < 90000; t += periodMs) {
+    double h = rocketHeightM(t / 1000.0) + noise(0.5);
+    detector.addPressureSample(pressureAt(h), t);
+  }
+
+  long apogeeLatencyMs =
+      (long)events[(uint8_t)FlightEvent::APOGEE] - ROCKET_APOGEE_S * 1000;
+  long landingLatencyMs =
+      (long)events[(uint8_t)FlightEvent::LANDING] - ROCKET_LANDING_S * 1000;
+  printf("pressure @%lums: launch at %lums, apogee latency %ldms, landing "
+         "latency %ldms\n",
+         periodMs, events[(uint8_t)FlightEvent::LAUNCH], apogeeLatencyMs,
+         landingLatencyMs);
+
+  checkAllEventsOnce();
+  CHECK(detector.phase() == FlightPhase::LANDED);
+  CHECK(fabs(detector.maxHeightM() - 300) < 3);
+  // apogee needs a 2m drop plus 3 confirming samples
+  CHECK(apogeeLatencyMs > 0 && apogeeLatencyMs <= 1000 + 3 * (long)periodMs);
+  CHECK(landingLatencyMs > 0 && landingLatencyMs <= 6000 + (long)periodMs);
+}
+
+/// GPS-only replay: zeros without a fix must not set the ground reference.
+static void replayGpsWithoutFix(void) {
+  FlightPhaseDetector detector;
+  resetEvents(detector);
+
+  const double groundAltitudeM = 420;
+  for (unsigned long t = 0; t < 90000; t += 200) {
+    bool fix = t >= 2000;
+    double alt = fix ? groundAltitudeM + rocketHeightM(t / 1000.0) : 0;
+    detector.addGpsAltitudeSample(alt, fix, t);
+  }
+
+  checkAllEventsOnce();
+  CHECK(events[(uint8_t)FlightEvent::LAUNCH] >= 10000);
+  CHECK(fabs(detector.maxHeightM() - 300) < 3);
+  printf("gps @200ms: apogee latency %ldms\n",
+         (long)events[(uint8_t)FlightEvent::APOGEE] -
+             (long)(ROCKET_APOGEE_S * 1000));
+}
+
+/// Barometer drops out during the ascent: the GPS, with a 60m ground
+/// reference error, takes over without triggering a false apogee.
+static void replaySourceSwitch(void) {
+  FlightPhaseDetector detector;
+  resetEvents(detector);
+
+  for (unsigned long t = 0; t < 90000; t += 100) {
+    double h = rocketHeightM(t / 1000.0);
+    bool baroAlive = t < 14000 || t > 25000;
+    if (baroAlive) {
+      detector.addPressureSample(pressureAt(h), t);
+    }
+    double gpsError = t < 1000 ? 0 : -60;
+    detector.addGpsAltitudeSample(100 + h + gpsError, true, t);
+  }
+
+  checkAllEventsOnce();
+  long apogeeLatencyMs =
+      (long)events[(uint8_t)FlightEvent::APOGEE] - ROCKET_APOGEE_S * 1000;
+  printf("source switch: apogee latency %ldms\n", apogeeLatencyMs);
+  CHECK(apogeeLatencyMs > 0 && apogeeLatencyMs <= 1500);
+}
+
+/// GPS-only replay at 1Hz, polled every 100ms, with the fix lost during the
+/// descent. Readings are only fed when new (see Gps::altitudeUpdated): the
+/// frozen altitude the GPS keeps reporting without a fix must not land the
+/// detector mid-air, and each reading counts once towards confirmations.
+static void replayStaleGpsFix(void) {
+  FlightPhaseDetector detector;
+  resetEvents(detector);
+
+  double altitudeM = 0;
+  bool updated = false;
+  for (unsigned long t = 0; t < 90000; t += 100) {
+    bool fix = t < 25000 || t >= 40000;
+    if (fix && t % 1000 == 0) {
+      altitudeM = 420 + rocketHeightM(t / 1000.0);
+      updated = true;
+    }
+    if (updated) {
+      detector.addGpsAltitudeSample(altitudeM, true, t);
+      updated = false;
+    }
+  }
+
+  checkAllEventsOnce();
+  long apogeeLatencyMs =
+      (long)events[(uint8_t)FlightEvent::APOGEE] - ROCKET_APOGEE_S * 1000;
+  long landingLatencyMs =
+      (long)events[(uint8_t)FlightEvent::LANDING] - ROCKET_LANDING_S * 1000;
+  printf("gps @1Hz with outage: apogee latency %ldms, landing latency %ldms\n",
+         apogeeLatencyMs, landingLatencyMs);
+  // 3 confirming readings take at least 2s at 1Hz
+  CHECK(apogeeLatencyMs >= 2000 && apogeeLatencyMs <= 4000);
+  CHECK(landingLatencyMs > 0 && landingLatencyMs <= 7000);
+}
+
+int main(void) {
+  replayPressure(100);
+  replayPressure(50);
+  replayPressure(1000);
+  replayGpsWithoutFix();
+  replaySourceSwitch();
+  replayStaleGpsFix();
+  printf("flight_replay: OK\n");
+  return 0;
+}
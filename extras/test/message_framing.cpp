@@ -0,0 +1,172 @@
+// Checks the packets written by BufferedPrint in message mode.
+#include "check.h"
+#include <buffered_print.h>
+#include <messages.h>
+#include <radio.h>
+
+using namespace CJKit;
+
+/// Keeps the packets written out, like a radio would send them.
+class PacketLog : public BufferedPrint<61> {
+public:
+  uint8_t packets[8][61];
+  uint8_t lens[8];
+  uint8_t count = 0;
+
+protected:
+  void write_unbuffered(uint8_t const *buf, int size) final {
+    memcpy(packets[count], buf, size);
+    lens[count++] = size;
+  }
+};
+
+static char lastMessage[256];
+static uint8_t messageCount = 0;
+
+static void onMessage(uint8_t const *message, size_t len) {
+  memcpy(lastMessage, message, len);
+  lastMessage[len] = 0;
+  messageCount++;
+}
+
+/// Plain output before the first message goes out in its own packet.
+static void plainOutputBeforeMessages(void) {
+  PacketLog log;
+  log.print("raw");
+  log.beginMessage();
+  log.print("hello");
+  log.endMessage();
+  log.flush();
+
+  CHECK(log.count == 2);
+  CHECK(log.lens[0] == 3 && memcmp(log.packets[0], "raw", 3) == 0);
+
+  MessageReassembler<64> reassembler(onMessage);
+  reassembler.feed(log.packets[1], log.lens[1]);
+  CHECK(messageCount == 1);
+  CHECK(strcmp(lastMessage, "hello") == 0);
+}
+
+/// Prints a message of len bytes, repeating the given text.
+template <typename Output>
+static void printMessage(Output &out, char const *text, size_t len) {
+  out.beginMessage();
+  for (size_t i = 0; i < len; i++) {
+    out.print(text[i % strlen(text)]);
+  }
+  out.endMessage();
+}
+
+/// Small messages are packed together in a single packet.
+static void smallMessagesShareAPacket(void) {
+  PacketLog log;
+  printMessage(log, "a", 2);
+  printMessage(log, "b", 3);
+  printMessage(log, "c", 4);
+  log.flush();
+
+  CHECK(log.count == 1);
+  CHECK(log.lens[0] == MESSAGE_PACKET_HEADER_SIZE + 3 + 2 + 3 + 4);
+
+  messageCount = 0;
+  MessageReassembler<64> reassembler(onMessage);
+  reassembler.feed(log.packets[0], log.lens[0]);
+  CHECK(messageCount == 3);
+  CHECK(strcmp(lastMessage, "cccc") == 0);
+}
+
+/// A message that does not fit in the rest of the packet moves whole to the
+/// next one.
+static void overflowMovesMessageWhole(void) {
+  PacketLog log;
+  printMessage(log, "a", 40);
+  printMessage(log, "b", 30);
+  log.flush();
+
+  CHECK(log.count == 2);
+  CHECK(log.lens[0] == MESSAGE_PACKET_HEADER_SIZE + 1 + 40);
+  CHECK(log.lens[1] == MESSAGE_PACKET_HEADER_SIZE + 1 + 30);
+  CHECK(log.packets[1][MESSAGE_PACKET_HEADER_SIZE] ==
+        (MESSAGE_CHUNK_START | MESSAGE_CHUNK_END | 30));
+
+  messageCount = 0;
+  MessageReassembler<64> reassembler(onMessage);
+  reassembler.feed(log.packets[0], log.lens[0]);
+  reassembler.feed(log.packets[1], log.lens[1]);
+  CHECK(messageCount == 2);
+  CHECK(strlen(lastMessage) == 30 && lastMessage[0] == 'b');
+  CHECK(reassembler.droppedMessages() == 0);
+}
+
+/// Messages longer than a packet are fragmented by StreamedRadio and rebuilt
+/// on the other side.
+static void fragmentedOverRadio(void) {
+  StreamedRadio<0, 1> sender;
+  StreamedRadio<1, 0> receiver;
+  CHECK(sender.begin() && receiver.begin());
+
+  const char text[] = "0123456789";
+  printMessage(sender, text, 150);
+  printMessage(sender, text, 5);
+  sender.flush();
+
+  messageCount = 0;
+  MessageReassembler<200> reassembler(onMessage);
+  uint8_t packets = 0;
+  uint8_t buf[RADIO_PAYLOAD_MAX_SIZE];
+  uint8_t len;
+  while ((len = receiver.receive(buf, sizeof(buf))) > 0) {
+    reassembler.feed(buf, len);
+    packets++;
+  }
+
+  CHECK(packets == 3);
+  CHECK(messageCount == 2);
+  CHECK(reassembler.droppedMessages() == 0);
+  CHECK(strcmp(lastMessage, "01234") == 0);
+}
+
+/// Losing a fragment drops its message, but not the following ones.
+static void lostFragmentDropsMessage(void) {
+  PacketLog log;
+  printMessage(log, "a", 150);
+  printMessage(log, "b", 10);
+  log.flush();
+  CHECK(log.count == 3);
+
+  messageCount = 0;
+  MessageReassembler<200> reassembler(onMessage);
+  reassembler.feed(log.packets[0], log.lens[0]);
+  reassembler.feed(log.packets[2], log.lens[2]);
+  CHECK(messageCount == 1);
+  CHECK(strcmp(lastMessage, "bbbbbbbbbb") == 0);
+  CHECK(reassembler.droppedMessages() == 1);
+}
+
+/// Messages longer than MAX_MESSAGE_SIZE are dropped.
+static void oversizeMessageDropped(void) {
+  PacketLog log;
+  printMessage(log, "a", 100);
+  printMessage(log, "b", 10);
+  log.flush();
+
+  messageCount = 0;
+  MessageReassembler<32> reassembler(onMessage);
+  for (uint8_t i = 0; i < log.count; i++) {
+    reassembler.feed(log.packets[i], log.lens[i]);
+  }
+  CHECK(messageCount == 1);
+  CHECK(strcmp(lastMessage, "bbbbbbbbbb") == 0);
+  CHECK(reassembler.droppedMessages() == 1);
+}
+
+int main(void) {
+  plainOutputBeforeMessages();
+  smallMessagesShareAPacket();
+  overflowMovesMessageWhole();
+  fragmentedOverRadio();
+  lostFragmentDropsMessage();
+  oversizeMessageDropped();
+  printf("message_framing: OK\n");
+  return 0;
+}
@@ -0,0 +1,261 @@
+// Runs ReliableRadio links over the fake radio channel (see stubs/RFM69.h).
+#include "check.h"
+#include <radio.h>
+#include <messages.h>
+#include <reliable_radio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace CJKit;
+
+/// BufferedPrint without any state of its own.
+class NullPrint : public BufferedPrint<RADIO_PAYLOAD_MAX_SIZE> {
+protected:
+  void write_unbuffered(uint8_t const *, int) final {}
+};
+
+// a plain radio must not pay for reliable mode
+static_assert(sizeof(StreamedRadio<>) <=
+                  sizeof(NullPrint) + sizeof(RadioDevice<0, 1, 100>),
+              "StreamedRadio has extra state");
+
+/// Sends count packets from sender to receiver, one every 100ms.
+/// @returns Average loss rate reported by the sender.
+template <typename Sender, typename Receiver>
+static float exchange(Sender &sender, Receiver &receiver, uint16_t count) {
+  float lossRateSum = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    sender.print("packet ");
+    sender.print(i);
+    sender.flush();
+
+    for (uint8_t k = 0; k < 10; k++) {
+      uint8_t buf[RADIO_PAYLOAD_MAX_SIZE];
+      receiver.receive(buf, sizeof(buf));
+      sender.poll();
+    }
+    delay(100);
+    sender.poll();
+    lossRateSum += sender.linkStats().lossRate;
+  }
+  return lossRateSum / count;
+}
+
+/// Each lost transmission counts towards the loss rate, not only packets that
+/// were given up on.
+static void lossRatePerTransmission(void) {
+  ReliableRadio<0, 1, 100, 8> sender;
+  ReliableRadio<1, 0, 100, 8> receiver;
+  CHECK(sender.begin() && receiver.begin());
+
+  fakeRadioSetLoss(0);
+  CHECK(exchange(sender, receiver, 100) < 0.01f);
+
+  // lost ACKs are mostly covered by the next one, so about 30% of the
+  // transmissions go unacknowledged
+  fakeRadioSetLoss(30);
+  float lossRate = exchange(sender, receiver, 300);
+  RadioLinkStats const &stats = sender.linkStats();
+  printf("30%% loss: lossRate=%.3f sent=%u lost=%u retransmissions=%u\n",
+         lossRate, (unsigned)stats.packetsSent,
+         (unsigned)stats.packetsLost, (unsigned)stats.retransmissions);
+  CHECK(lossRate > 0.15f && lossRate < 0.45f);
+  CHECK(stats.packetsLost < stats.packetsSent / 20);
+}
+
+/// Power goes down on a good link and back up once transmissions get lost.
+static void adaptivePowerFollowsLoss(void) {
+  ReliableRadio<0, 1, 100, 4> sender;
+  ReliableRadio<1, 0, 100, 4> receiver;
+  CHECK(sender.begin() && receiver.begin());
+
+  // the fake channel reports power - 85dBm as RSSI
+  sender.setAdaptivePower(true, -95, -2, 5);
+  fakeRadioSetLoss(0);
+  exchange(sender, receiver, 200);
+  CHECK(sender.txPowerDBm() == -2);
+
+  fakeRadioSetLoss(30);
+  exchange(sender, receiver, 200);
+  printf("adaptive power: %ddBm after losses\n", sender.txPowerDBm());
+  CHECK(sender.txPowerDBm() == 5);
+  fakeRadioSetLoss(0);
+}
+
+static long nextMessageId = 0;
+static bool messagesInOrder = true;
+
+static void onMessage(uint8_t const *message, size_t len) {
+  char text[16] = {0};
+  memcpy(text, message, min(len, sizeof(text) - 1));
+  long id = atol(text + 4); // "msg <id> ..."
+  if (id != nextMessageId) {
+    messagesInOrder = false;
+  }
+  nextMessageId = id + 1;
+}
+
+/// Messages split over several packets arrive whole and in order despite
+/// losses, as ReliableRadio delivers packets in order.
+static void messagesSurviveLoss(void) {
+  ReliableRadio<0, 1, 100, 8> sender;
+  ReliableRadio<1, 0, 100, 8> receiver;
+  CHECK(sender.begin() && receiver.begin());
+  MessageReassembler<200> reassembler(onMessage);
+
+  fakeRadioSetLoss(10);
+  const long count = 500;
+  for (long i = 0; i < count + 20; i++) {
+    if (i < count) {
+      sender.beginMessage();
+      sender.print("msg ");
+      sender.print(i);
+      // every 4th message spans several packets
+      for (uint8_t k = 0; k < (i % 4 == 0 ? 12 : 1); k++) {
+        sender.print(" data");
+      }
+      sender.endMessage();
+      if (i % 2 == 1) {
+        sender.flush();
+      }
+    }
+
+    for (uint8_t k = 0; k < 10; k++) {
+      uint8_t buf[RADIO_PAYLOAD_MAX_SIZE];
+      uint8_t len = receiver.receive(buf, sizeof(buf));
+      if (len > 0) {
+        reassembler.feed(buf, len);
+      }
+      sender.poll();
+    }
+    delay(100);
+    sender.poll();
+  }
+  fakeRadioSetLoss(0);
+
+  printf("10%% loss: %ld/%ld messages, %u dropped, %u packets lost\n",
+         nextMessageId, count, (unsigned)reassembler.droppedMessages(),
+         (unsigned)sender.linkStats().packetsLost);
+  CHECK(messagesInOrder);
+  CHECK(nextMessageId == count);
+  CHECK(reassembler.droppedMessages() == 0);
+}
+
+static uint8_t acksToLose = 0;
+
+static bool loseFirstAcks(uint8_t from, uint8_t, uint8_t const *data,
+                          uint8_t) {
+  if (from == 1 && data[0] == RADIO_FRAME_ACK && acksToLose > 0) {
+    acksToLose--;
+    return true;
+  }
+  return false;
+}
+
+/// Sends one single-letter packet per letter, appending the letters returned
+/// by the receiver to received.
+template <typename Sender, typename Receiver>
+static void sendLetters(Sender &sender, Receiver &receiver,
+                        char const *letters, char *received) {
+  size_t n = strlen(received);
+  for (char const *c = letters; *c != '\0'; c++) {
+    sender.print(*c);
+    sender.flush();
+
+    for (uint8_t k = 0; k < 50; k++) {
+      uint8_t buf[RADIO_PAYLOAD_MAX_SIZE];
+      uint8_t len = receiver.receive(buf, sizeof(buf));
+      if (len > 0) {
+        received[n++] = buf[0];
+      }
+      delay(20);
+      sender.poll();
+    }
+  }
+  received[n] = '\0';
+}
+
+/// Retransmissions of packets already delivered (their ACKs were lost) are
+/// not delivered again, while a restarted sender starts a new session.
+static void lostAcksAtStartup(void) {
+  ReliableRadio<1, 0, 100, 8> receiver;
+  CHECK(receiver.begin());
+  char received[16] = {0};
+  fakeRadioSetLossFilter(loseFirstAcks);
+
+  {
+    ReliableRadio<0, 1, 100, 8> sender;
+    CHECK(sender.begin());
+    acksToLose = 3;
+    sendLetters(sender, receiver, "ABCDEF", received);
+    printf("lost ACKs at startup: received %s\n", received);
+    CHECK(strcmp(received, "ABCDEF") == 0);
+    CHECK(sender.linkStats().packetsLost == 0);
+  }
+
+  // a rebooted sender starts over from sequence number 0
+  ReliableRadio<0, 1, 100, 8> restarted;
+  CHECK(restarted.begin());
+  acksToLose = 3;
+  sendLetters(restarted, receiver, "GH", received);
+  fakeRadioSetLossFilter(nullptr);
+  CHECK(strcmp(received, "ABCDEFGH") == 0);
+}
+
+/// Receives the pending packets, checking they count up from next.
+template <typename Radio>
+static bool receiveCounting(Radio &radio, uint16_t &next) {
+  bool inOrder = true;
+  uint8_t buf[RADIO_PAYLOAD_MAX_SIZE];
+  uint8_t len;
+  while ((len = radio.receive(buf, sizeof(buf) - 1)) > 0) {
+    buf[len] = '\0';
+    inOrder = inOrder && atol((char const *)buf) == next;
+    next++;
+  }
+  return inOrder;
+}
+
+/// Data packets that arrive while a node polls for its own ACKs (e.g. when
+/// sending) are kept for receive.
+static void bothNodesSend(void) {
+  ReliableRadio<0, 1, 100, 8> a;
+  ReliableRadio<1, 0, 100, 8> b;
+  CHECK(a.begin() && b.begin());
+
+  fakeRadioSetLoss(10);
+  uint16_t aNext = 0, bNext = 0;
+  bool inOrder = true;
+  const uint16_t count = 200;
+  for (uint16_t i = 0; i < count + 20; i++) {
+    if (i < count) {
+      a.print(i);
+      a.flush();
+      b.print(i);
+      b.flush();
+    }
+
+    for (uint8_t k = 0; k < 10; k++) {
+      inOrder = receiveCounting(a, aNext) && inOrder;
+      inOrder = receiveCounting(b, bNext) && inOrder;
+      delay(10);
+      a.poll();
+      b.poll();
+    }
+  }
+  fakeRadioSetLoss(0);
+
+  printf("both nodes send: %u and %u/%u packets\n", aNext, bNext, count);
+  CHECK(inOrder);
+  CHECK(aNext == count && bNext == count);
+}
+
+int main(void) {
+  lossRatePerTransmission();
+  adaptivePowerFollowsLoss();
+  messagesSurviveLoss();
+  lostAcksAtStartup();
+  bothNodesSend();
+  printf("reliable_link: OK\n");
+  return 0;
+}
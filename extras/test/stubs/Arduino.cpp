@@ -0,0 +1,29 @@
+#include <Arduino.h>
+#include <stdio.h>
+
+HardwareSerial Serial;
+
+static unsigned long fakeNowUs = 0;
+
+unsigned long millis(void) { return fakeNowUs / 1000; }
+unsigned long micros(void) { return fakeNowUs; }
+void delay(unsigned long ms) { fakeNowUs += ms * 1000; }
+void fakeAdvanceUs(unsigned long us) { fakeNowUs += us; }
+
+size_t Print::print(long n, int base) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), base == 16 ? "%lx" : "%ld", n);
+  return write(buf);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), base == 16 ? "%lx" : "%lu", n);
+  return write(buf);
+}
+
+size_t Print::print(double d, int digits) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, d);
+  return write(buf);
+}
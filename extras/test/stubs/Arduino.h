@@ -0,0 +1,75 @@
+// Minimal Arduino API for host tests: Print, a Serial that discards output and
+// a fake clock that only moves when told to (see fakeAdvanceUs).
+#ifndef _CJKIT_TEST_ARDUINO_H
+#define _CJKIT_TEST_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+typedef uint8_t byte;
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+
+/// Moves the fake clock forward.
+void fakeAdvanceUs(unsigned long us);
+
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(uint8_t const *buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+      n += write(*buffer++);
+    }
+    return n;
+  }
+  size_t write(char const *str) {
+    return write((uint8_t const *)str, strlen(str));
+  }
+  virtual int availableForWrite(void) { return 0; }
+  virtual void flush(void) {}
+
+  size_t print(char const *str) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(long n, int base = 10);
+  size_t print(unsigned long n, int base = 10);
+  size_t print(int n, int base = 10) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = 10) {
+    return print((unsigned long)n, base);
+  }
+  size_t print(double d, int digits = 2);
+
+  size_t println(void) { return write("\r\n"); }
+  template <typename T> size_t println(T value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <typename T> size_t println(T value, int arg) {
+    size_t n = print(value, arg);
+    return n + println();
+  }
+};
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t) override { return 1; }
+  size_t write(uint8_t const *, size_t size) override { return size; }
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+class SPIClass {};
+
+#endif
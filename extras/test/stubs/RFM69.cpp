@@ -0,0 +1,89 @@
+#include <RFM69.h>
+#include <airtime.h>
+
+static RFM69 *radios = nullptr;
+static uint8_t lossPercent = 0;
+static FakeLossFilter *lossFilter = nullptr;
+static FakeTransmitHook *transmitHook = nullptr;
+static uint32_t randomState = 1;
+
+static bool lost(uint8_t from, uint8_t to, uint8_t const *data, uint8_t len) {
+  if (lossFilter != nullptr) {
+    return lossFilter(from, to, data, len);
+  }
+  randomState = randomState * 1103515245 + 12345;
+  return ((randomState >> 16) % 100) < lossPercent;
+}
+
+void fakeRadioSetLoss(uint8_t percent) { lossPercent = percent; }
+void fakeRadioSetLossFilter(FakeLossFilter *filter) { lossFilter = filter; }
+void fakeRadioSetTransmitHook(FakeTransmitHook *hook) { transmitHook = hook; }
+
+RFM69::RFM69(uint8_t, uint8_t, bool, SPIClass *) {
+  _nextRadio = radios;
+  radios = this;
+}
+
+RFM69::~RFM69() {
+  for (RFM69 **r = &radios; *r != nullptr; r = &(*r)->_nextRadio) {
+    if (*r == this) {
+      *r = _nextRadio;
+      break;
+    }
+  }
+}
+
+bool RFM69::initialize(uint8_t, uint16_t nodeId, uint8_t networkId) {
+  _initialized = true;
+  _nodeId = nodeId;
+  _networkId = networkId;
+  _queueLen = 0;
+  return true;
+}
+
+void RFM69::send(uint16_t to, void const *buffer, uint8_t size, bool) {
+  if (size > RF69_MAX_DATA_LEN) {
+    size = RF69_MAX_DATA_LEN;
+  }
+
+  uint32_t airtimeUs = CJKit::AirtimeBudget::packetAirtimeUs(size, encrypted);
+  if (transmitHook != nullptr) {
+    transmitHook(_nodeId, micros(), airtimeUs);
+  }
+  fakeAdvanceUs(airtimeUs);
+  sentPackets++;
+
+  uint8_t const *data = (uint8_t const *)buffer;
+  for (RFM69 *r = radios; r != nullptr; r = r->_nextRadio) {
+    if (r == this || !r->_initialized || r->_nodeId != to ||
+        r->_networkId != _networkId || r->encrypted != encrypted) {
+      continue;
+    }
+    if (lost(_nodeId, to, data, size) || r->_queueLen == QUEUE_SIZE) {
+      continue;
+    }
+
+    _Packet &p = r->_queue[(r->_queueHead + r->_queueLen++) % QUEUE_SIZE];
+    p.from = _nodeId;
+    p.len = size;
+    p.rssi = powerDBm - 85;
+    memcpy(p.data, data, size);
+  }
+}
+
+bool RFM69::receiveDone(void) {
+  if (_queueLen == 0) {
+    return false;
+  }
+
+  _Packet &p = _queue[_queueHead];
+  _queueHead = (_queueHead + 1) % QUEUE_SIZE;
+  _queueLen--;
+
+  SENDERID = p.from;
+  DATALEN = p.len;
+  RSSI = p.rssi;
+  memcpy(DATA, p.data, p.len);
+  DATA[p.len] = 0;
+  return true;
+}
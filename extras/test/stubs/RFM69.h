@@ -0,0 +1,78 @@
+// Fake RFM69 radio for host tests. All radios share a simulated channel:
+// sending moves the fake clock forward by the packet's airtime and queues the
+// packet at the destination radio, unless the channel loses it.
+#ifndef _CJKIT_TEST_RFM69_H
+#define _CJKIT_TEST_RFM69_H
+
+#include <Arduino.h>
+
+#define RF69_433MHZ 43
+#define RF69_MAX_DATA_LEN 61
+
+/// Decides if a packet is lost (see fakeRadioSetLossFilter).
+typedef bool(FakeLossFilter)(uint8_t from, uint8_t to, uint8_t const *data,
+                             uint8_t len);
+
+/// Called on each transmission with its start time and airtime in µs.
+typedef void(FakeTransmitHook)(uint8_t from, unsigned long startUs,
+                               uint32_t airtimeUs);
+
+class RFM69 {
+private:
+  static const uint8_t QUEUE_SIZE = 8;
+
+  struct _Packet {
+    uint8_t from;
+    uint8_t len;
+    int16_t rssi;
+    uint8_t data[RF69_MAX_DATA_LEN];
+  };
+
+  _Packet _queue[QUEUE_SIZE];
+  uint8_t _queueHead = 0;
+  uint8_t _queueLen = 0;
+  bool _initialized = false;
+  uint8_t _nodeId = 0;
+  uint8_t _networkId = 0;
+  RFM69 *_nextRadio = nullptr;
+
+public:
+  uint8_t DATA[RF69_MAX_DATA_LEN + 1];
+  uint8_t DATALEN = 0;
+  uint8_t SENDERID = 0;
+  int16_t RSSI = 0;
+
+  int8_t powerDBm = 13;
+  uint32_t frequency = 0;
+  bool encrypted = false;
+  uint32_t sentPackets = 0;
+
+  RFM69(uint8_t slaveSelectPin = 10, uint8_t interruptPin = 2,
+        bool isRFM69HW = false, SPIClass *spi = nullptr);
+  virtual ~RFM69();
+
+  bool initialize(uint8_t freqBand, uint16_t nodeId, uint8_t networkId);
+  void send(uint16_t to, void const *buffer, uint8_t size,
+            bool requestACK = false);
+  bool receiveDone(void);
+
+  void setHighPower(bool = true) {}
+  void encrypt(char const *key) { encrypted = key != nullptr; }
+  int8_t setPowerDBm(int8_t dBm) {
+    powerDBm = constrain(dBm, -18, 13);
+    return powerDBm;
+  }
+  void setFrequency(uint32_t freq) { frequency = freq; }
+  int16_t readRSSI(bool = false) { return -100 - (int16_t)(micros() % 8); }
+};
+
+/// Loses the given percentage of packets, at random.
+void fakeRadioSetLoss(uint8_t percent);
+
+/// Loses the packets selected by filter (nullptr to go back to random loss).
+void fakeRadioSetLossFilter(FakeLossFilter *filter);
+
+/// Sets the hook called on each transmission (nullptr to clear it).
+void fakeRadioSetTransmitHook(FakeTransmitHook *hook);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef _CJKIT_TEST_RFM69_ATC_H
+#define _CJKIT_TEST_RFM69_ATC_H
+
+#include "RFM69.h"
+
+class RFM69_ATC : public RFM69 {
+public:
+  using RFM69::RFM69;
+};
+
+#endif
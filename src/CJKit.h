@@ -1,10 +1,16 @@
 #ifndef _CJKIT_H
 #define _CJKIT_H
 
+#include "airtime.h"
 #include "base.h"
+#include "fast_gpio.h"
+#include "flight.h"
 #include "gps.h"
+#include "messages.h"
+#include "patterns.h"
 #include "pressure.h"
 #include "radio.h"
+#include "reliable_radio.h"
 #include "temperature.h"
 
 #endif
@@ -0,0 +1,256 @@
+#ifndef _CJKIT_AIRTIME_H
+#define _CJKIT_AIRTIME_H
+
+#include <stdint.h>
+
+namespace CJKit {
+/// Radio bitrate (bits per second) set by the RFM69 library.
+const uint32_t RADIO_BITRATE_BPS = 55555;
+
+/// Bytes sent by the radio on top of the payload: preamble (3), sync word
+/// (2), length, target, sender and control bytes (4) and CRC (2).
+const uint8_t RADIO_PACKET_OVERHEAD_BYTES = 11;
+
+/// Bytes encrypted with the payload (target, sender and control bytes).
+const uint8_t RADIO_ENCRYPTED_HEADER_BYTES = 3;
+
+/// AES block size: encrypted data is padded to a multiple of it.
+const uint8_t RADIO_AES_BLOCK_BYTES = 16;
+
+/// Number of time slices tracked by AirtimeBudget.
+const uint8_t AIRTIME_BUDGET_BUCKETS = 30;
+
+/// Largest decimation factor suggested by AirtimeBudget.
+const uint8_t AIRTIME_MAX_DECIMATION = 64;
+
+/**
+ * Duty-cycle accounting for radio transmissions.
+ *
+ * Keeps track of the time spent transmitting (airtime) over a sliding window
+ * (e.g. the 10% per hour duty cycle limit for 433MHz) split into
+ * AIRTIME_BUDGET_BUCKETS time slices. The window is never shorter than
+ * configured, so budget checks may be slightly pessimistic but never exceed
+ * the limit.
+ *
+ * Telemetry producers can use AirtimeBudget::keepSample to down-sample so the
+ * recent transmission rate fits the budget, instead of being cut off once it
+ * is exhausted. The decimation factor is the airtime that would have been
+ * used without decimation over the last two time slices, against 90% of the
+ * budget for that time (leaving room for retransmissions), so it settles as
+ * soon as the sample rate is steady.
+ *
+ * All times are passed in by the caller (e.g. millis()), so this class does
+ * not depend on the Arduino environment and can be driven by a simulated radio
+ * (see AirtimeBudget::packetAirtimeUs).
+ */
+class AirtimeBudget {
+private:
+  unsigned long _bucketMs;
+  uint32_t _budgetUs;
+
+  /// Airtime per bucket in µs: the current one and a full window before it.
+  uint32_t _bucketUs[AIRTIME_BUDGET_BUCKETS + 1] = {0};
+  uint8_t _current = 0;
+  unsigned long _bucketStartMs = 0;
+  uint32_t _usedUs = 0;
+
+  /// Airtime that would have been used without decimation in the current and
+  /// previous buckets, in µs.
+  uint32_t _demandUs = 0;
+  uint32_t _prevDemandUs = 0;
+
+  float _decimation = 1;
+
+  /// Moves on to the bucket containing nowMs, forgetting expired buckets.
+  void _advance(unsigned long nowMs) {
+    for (uint8_t i = 0; i <= AIRTIME_BUDGET_BUCKETS &&
+                        nowMs - _bucketStartMs >= _bucketMs;
+         i++) {
+      _current = (_current + 1) % (AIRTIME_BUDGET_BUCKETS + 1);
+      _usedUs -= _bucketUs[_current];
+      _bucketUs[_current] = 0;
+      _bucketStartMs += _bucketMs;
+      _prevDemandUs = _demandUs;
+      _demandUs = 0;
+    }
+
+    if (nowMs - _bucketStartMs >= _bucketMs) {
+      // idle for over a window: everything expired already
+      _bucketStartMs = nowMs;
+    }
+
+    _updateDecimation(nowMs);
+  }
+
+  /// Recomputes the decimation factor from the demand in the last two
+  /// buckets.
+  void _updateDecimation(unsigned long nowMs) {
+    uint32_t elapsedMs = _bucketMs + (nowMs - _bucketStartMs);
+    float allowed = (float)_budgetUs * 0.9f * elapsedMs /
+                    (_bucketMs * AIRTIME_BUDGET_BUCKETS);
+    float factor = (_prevDemandUs + _demandUs) / allowed;
+
+    if (factor <= 1) {
+      _decimation = 1;
+    } else if (factor >= AIRTIME_MAX_DECIMATION) {
+      _decimation = AIRTIME_MAX_DECIMATION;
+    } else {
+      _decimation = factor;
+    }
+  }
+
+public:
+  /**
+   * Create an airtime budget.
+   *
+   * @param windowMs - Duty cycle window in ms (1 hour by default).
+   * @param dutyCycle - Fraction of the window that may be spent transmitting
+   * (10% by default).
+   * @param nowMs - Current time in ms.
+   */
+  AirtimeBudget(unsigned long windowMs = 3600000UL, float dutyCycle = 0.1f,
+                unsigned long nowMs = 0)
+      : _bucketMs((windowMs + AIRTIME_BUDGET_BUCKETS - 1) /
+                  AIRTIME_BUDGET_BUCKETS),
+        _budgetUs((uint32_t)(windowMs * 1000.0f * dutyCycle)),
+        _bucketStartMs(nowMs) {}
+
+  /**
+   * Estimated airtime of a packet, in µs.
+   *
+   * @param payloadLen - Payload size in bytes.
+   * @param encrypted - True if the radio encrypts packets (see
+   * StreamedRadio::setEncryptionKey), which pads them.
+   * @param bitrateBps - Radio bitrate in bits per second.
+   */
+  static uint32_t packetAirtimeUs(uint8_t payloadLen, bool encrypted = false,
+                                  uint32_t bitrateBps = RADIO_BITRATE_BPS) {
+    uint32_t bytes = payloadLen + RADIO_PACKET_OVERHEAD_BYTES;
+    if (encrypted) {
+      uint8_t partial =
+          (payloadLen + RADIO_ENCRYPTED_HEADER_BYTES) % RADIO_AES_BLOCK_BYTES;
+      bytes += partial == 0 ? 0 : RADIO_AES_BLOCK_BYTES - partial;
+    }
+    return (bytes * 8 * 1000000UL + bitrateBps - 1) / bitrateBps;
+  }
+
+  /**
+   * Account for a transmission.
+   *
+   * The transmission also counts as decimation() times its airtime towards
+   * the demand used for the decimation factor, as it stands for the samples
+   * decimated away.
+   *
+   * @param airtimeUs - Time spent transmitting in µs (see packetAirtimeUs).
+   * @param nowMs - Time the transmission started in ms.
+   */
+  void record(uint32_t airtimeUs, unsigned long nowMs) {
+    _advance(nowMs);
+    _bucketUs[_current] += airtimeUs;
+    _usedUs += airtimeUs;
+    _demandUs += (uint32_t)(airtimeUs * _decimation);
+    _updateDecimation(nowMs);
+  }
+
+  /**
+   * Check if a transmission fits in the remaining budget.
+   *
+   * @param airtimeUs - Expected airtime in µs (see packetAirtimeUs).
+   * @param nowMs - Current time in ms.
+   * @returns True if the transmission can happen now.
+   */
+  bool canSend(uint32_t airtimeUs, unsigned long nowMs) {
+    _advance(nowMs);
+    return _usedUs + airtimeUs <= _budgetUs;
+  }
+
+  /**
+   * Account for a transmission if it fits in the remaining budget (what
+   * StreamedRadio does with each packet).
+   *
+   * Refused transmissions still count towards the demand used for the
+   * decimation factor (like in record), so the factor keeps rising while the
+   * budget is exhausted.
+   *
+   * @param airtimeUs - Expected airtime in µs (see packetAirtimeUs).
+   * @param nowMs - Current time in ms.
+   * @param retry - True if the transmission was refused before, so it does
+   * not count towards the demand again.
+   * @returns True if the transmission can happen now (it was recorded).
+   */
+  bool acquire(uint32_t airtimeUs, unsigned long nowMs, bool retry = false) {
+    _advance(nowMs);
+    bool fits = _usedUs + airtimeUs <= _budgetUs;
+    if (fits) {
+      _bucketUs[_current] += airtimeUs;
+      _usedUs += airtimeUs;
+    }
+    if (!retry) {
+      _demandUs += (uint32_t)(airtimeUs * _decimation);
+    }
+    _updateDecimation(nowMs);
+    return fits;
+  }
+
+  /**
+   * Time until a transmission fits in the budget.
+   *
+   * @param airtimeUs - Expected airtime in µs (see packetAirtimeUs).
+   * @param nowMs - Current time in ms.
+   * @returns Time to wait in ms (0 if it can be sent now).
+   */
+  unsigned long nextSlotMs(uint32_t airtimeUs, unsigned long nowMs) {
+    _advance(nowMs);
+    if (_usedUs + airtimeUs <= _budgetUs) {
+      return 0;
+    }
+
+    // buckets expire from the oldest, one at each bucket boundary
+    unsigned long waitMs = _bucketMs - (nowMs - _bucketStartMs);
+    uint32_t usedUs = _usedUs;
+    for (uint8_t i = 1; i <= AIRTIME_BUDGET_BUCKETS; i++) {
+      usedUs -= _bucketUs[(_current + i) % (AIRTIME_BUDGET_BUCKETS + 1)];
+      if (usedUs + airtimeUs <= _budgetUs) {
+        return waitMs;
+      }
+      waitMs += _bucketMs;
+    }
+
+    return waitMs; // larger than the whole budget
+  }
+
+  /**
+   * Suggested decimation factor for telemetry, from 1 to
+   * AIRTIME_MAX_DECIMATION: send 1 out of every decimation() samples. Rises
+   * when recent transmissions outpace the budget and returns to 1 when they
+   * fit. Updated by the other methods.
+   */
+  float decimation(void) const { return _decimation; }
+
+  /**
+   * Apply the decimation factor to a stream of samples. Call it for every
+   * sample, so the factor also comes down while few samples are sent.
+   *
+   * @param credit - Per-stream sample credit (start at 0).
+   * @param nowMs - Current time in ms.
+   * @returns True if the current sample should be sent.
+   */
+  bool keepSample(float &credit, unsigned long nowMs) {
+    _advance(nowMs);
+    credit += 1 / _decimation;
+    if (credit >= 1) {
+      credit -= 1;
+      return true;
+    }
+    return false;
+  }
+
+  /// Airtime used in the current window, in µs.
+  uint32_t usedUs(void) const { return _usedUs; }
+
+  /// Airtime allowed per window, in µs.
+  uint32_t budgetUs(void) const { return _budgetUs; }
+};
+} // namespace CJKit
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef _CJKIT_BUFFERED_PRINT_H
 #define _CJKIT_BUFFERED_PRINT_H
 
+#include "messages.h"
 #include <Arduino.h>
 
 namespace CJKit {
@@ -10,12 +11,66 @@ namespace CJKit {
  * Print methods will be buffered until the buffer is full or
  * BufferedPrint::flush is called. At that point, buffer contents will be
  * written using the overriden BufferedPrint::write_unbuffered method.
+ *
+ * Calling BufferedPrint::beginMessage switches to message mode, where output
+ * is grouped in messages: small messages are packed together in a buffer
+ * without being split, large messages are split into fragments over several
+ * buffers, and MessageReassembler rebuilds them on the receiving side. Each
+ * buffer then starts with a MESSAGE_PACKET_HEADER_SIZE header, and each message
+ * fragment with a 1-byte header.
  */
 template <size_t BUFFER_SIZE> class BufferedPrint : public Print {
 private:
   uint8_t _buffer[BUFFER_SIZE] = {0};
   uint8_t _buffer_len = 0;
 
+  /// Message mode state (see beginMessage), packed to spare RAM in plain
+  /// mode.
+  bool _messages : 1;
+  bool _in_message : 1;
+  bool _message_continued : 1;
+  uint8_t _chunk_start = 0;
+  uint8_t _packet_counter = 0;
+
+  /// Starts a new buffer in message mode.
+  void _startPacket(void) {
+    _buffer[0] = _packet_counter++;
+    _buffer_len = MESSAGE_PACKET_HEADER_SIZE;
+  }
+
+  /// Starts a new chunk (message fragment) in the buffer.
+  void _openChunk(void) {
+    _chunk_start = _buffer_len;
+    _buffer[_buffer_len++] = 0;
+  }
+
+  /// Fills in the header of the current chunk.
+  void _closeChunk(bool end) {
+    uint8_t len = _buffer_len - _chunk_start - 1;
+    _buffer[_chunk_start] = (_message_continued ? 0 : MESSAGE_CHUNK_START) |
+                            (end ? MESSAGE_CHUNK_END : 0) | len;
+  }
+
+  /// Makes room in a full buffer for the current message.
+  void _overflowMessage(void) {
+    if (!_message_continued && _chunk_start > MESSAGE_PACKET_HEADER_SIZE) {
+      // write out the previous messages and move this one to a new buffer
+      uint8_t len = _buffer_len - _chunk_start;
+      write_unbuffered(_buffer, _chunk_start);
+      _startPacket();
+      memmove(_buffer + _buffer_len, _buffer + _chunk_start, len);
+      _chunk_start = _buffer_len;
+      _buffer_len += len;
+    } else {
+      // message does not fit a single buffer: fragment it
+      _closeChunk(false);
+      write_unbuffered(_buffer, _buffer_len);
+      _message_continued = true;
+      _startPacket();
+      _openChunk();
+    }
+  }
+
 protected:
   /**
    * Write buffer contents to underlying output (e.g. radio).
@@ -23,19 +78,29 @@ protected:
    * @param buffer - Pointer to memory region to be written.
    * @param len - Size of the memory region to be written.
    */
-  virtual void write_unbuffered(uint8_t const *buffer, int len);
+  virtual void write_unbuffered(uint8_t const *buffer, int len) = 0;
 
 public:
+  BufferedPrint(void)
+      : _messages(false), _in_message(false), _message_continued(false) {}
+
   /**
    * Remaining free space in the buffer.
    */
   size_t bufferSpace(void) const { return BUFFER_SIZE - _buffer_len; }
 
+  /**
+   * True once BufferedPrint::beginMessage switched to message mode.
+   */
+  bool messageMode(void) const { return _messages; }
+
   /**
    * Flushes buffer contents (if not empty), writing them to the underlying
-   * output and clearing the buffer.
+   * output and clearing the buffer. In message mode, this also ends the
+   * current message.
    */
   void flush(void) {
+    endMessage();
     if (_buffer_len == 0) {
       return;
     }
@@ -44,11 +109,62 @@ public:
     _buffer_len = 0;
   }
 
+  /**
+   * Start a new message, switching to message mode (see BufferedPrint). Ends
+   * the current message if there is one.
+   *
+   * Once in message mode, output written outside beginMessage/endMessage
+   * starts a new message, which lasts until the next call to endMessage,
+   * beginMessage or flush.
+   */
+  void beginMessage(void) {
+    static_assert(BUFFER_SIZE <= MESSAGE_CHUNK_LEN_MASK + 2,
+                  "buffer too large for message mode");
+
+    endMessage();
+    if (!_messages && _buffer_len != 0) {
+      flush(); // plain output, not laid out as messages
+    }
+    _messages = true;
+
+    if (bufferSpace() < 2) {
+      flush();
+    }
+    if (_buffer_len == 0) {
+      _startPacket();
+    }
+
+    _openChunk();
+    _in_message = true;
+    _message_continued = false;
+  }
+
+  /**
+   * End the current message (if any). The message is written out together
+   * with the following ones when the buffer fills up or flush is called.
+   */
+  void endMessage(void) {
+    if (!_in_message) {
+      return;
+    }
+
+    _closeChunk(true);
+    _in_message = false;
+  }
+
   size_t write(uint8_t const *buffer, size_t size) final {
+    if (_messages && !_in_message) {
+      beginMessage();
+    }
+
     size_t i = 0;
     while (i < size) {
       if (bufferSpace() == 0) {
-        flush();
+        if (_in_message) {
+          _overflowMessage();
+        } else {
+          flush();
+        }
       }
 
       size_t sz = min(bufferSpace(), size - i);
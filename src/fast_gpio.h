@@ -0,0 +1,118 @@
+#ifndef _CJKIT_FAST_GPIO_H
+#define _CJKIT_FAST_GPIO_H
+
+#include "base.h"
+#include <Arduino.h>
+
+namespace CJKit {
+/**
+ * Digital pin with the pin number fixed at compile time.
+ *
+ * On supported boards (ATmega328P-based Arduino Nano and the ATmega4809-based
+ * Arduino Nano Every) each operation compiles to a single port register
+ * instruction, instead of the pin table lookups done by digitalWrite and
+ * friends. Operations on the same port register are interrupt-safe. On other
+ * boards, and for pins without a known mapping, the regular Arduino functions
+ * are used.
+ *
+ * All methods are static, so pins can be used without creating objects, e.g.
+ * FastPin<LED_BUILTIN>::high() or BuzzerPin::toggle().
+ */
+template <uint8_t PIN> struct FastPin {
+  /// True if this pin is driven through port registers.
+  static const bool IS_FAST = false;
+
+  /// Configure the pin as a digital output.
+  static void setOutput(void) { pinMode(PIN, OUTPUT); }
+
+  /// Set the pin HIGH.
+  static void high(void) { digitalWrite(PIN, HIGH); }
+
+  /// Set the pin LOW.
+  static void low(void) { digitalWrite(PIN, LOW); }
+
+  /// Invert the pin's output level.
+  static void toggle(void) { digitalWrite(PIN, !digitalRead(PIN)); }
+
+  /// Read the pin's level.
+  static bool read(void) { return digitalRead(PIN) == HIGH; }
+
+  /// Set the pin HIGH (true) or LOW (false).
+  static void write(bool level) { level ? high() : low(); }
+};
+
+/// @private Specializes FastPin for a pin number connected to bit BIT of the
+/// given output, direction and input port registers.
+#define _CJKIT_FAST_PIN(PIN, OUT_REG, DIR_REG, IN_REG, BIT)                    \
+  template <> struct FastPin<PIN> {                                            \
+    static const bool IS_FAST = true;                                          \
+    static const uint8_t MASK = 1 << (BIT);                                    \
+    static void setOutput(void) { DIR_REG |= MASK; }                           \
+    static void high(void) { OUT_REG |= MASK; }                                \
+    static void low(void) { OUT_REG &= ~MASK; }                                \
+    static void toggle(void) { IN_REG = MASK; /* writing 1 toggles */ }        \
+    static bool read(void) { return (IN_REG & MASK) != 0; }                    \
+    static void write(bool level) { level ? high() : low(); }                  \
+  }
+
+#if defined(__AVR_ATmega328P__)
+_CJKIT_FAST_PIN(0, PORTD, DDRD, PIND, 0);
+_CJKIT_FAST_PIN(1, PORTD, DDRD, PIND, 1);
+_CJKIT_FAST_PIN(2, PORTD, DDRD, PIND, 2);
+_CJKIT_FAST_PIN(3, PORTD, DDRD, PIND, 3);
+_CJKIT_FAST_PIN(4, PORTD, DDRD, PIND, 4);
+_CJKIT_FAST_PIN(5, PORTD, DDRD, PIND, 5);
+_CJKIT_FAST_PIN(6, PORTD, DDRD, PIND, 6);
+_CJKIT_FAST_PIN(7, PORTD, DDRD, PIND, 7);
+_CJKIT_FAST_PIN(8, PORTB, DDRB, PINB, 0);
+_CJKIT_FAST_PIN(9, PORTB, DDRB, PINB, 1);
+_CJKIT_FAST_PIN(10, PORTB, DDRB, PINB, 2);
+_CJKIT_FAST_PIN(11, PORTB, DDRB, PINB, 3);
+_CJKIT_FAST_PIN(12, PORTB, DDRB, PINB, 4);
+_CJKIT_FAST_PIN(13, PORTB, DDRB, PINB, 5);
+_CJKIT_FAST_PIN(14, PORTC, DDRC, PINC, 0);
+_CJKIT_FAST_PIN(15, PORTC, DDRC, PINC, 1);
+_CJKIT_FAST_PIN(16, PORTC, DDRC, PINC, 2);
+_CJKIT_FAST_PIN(17, PORTC, DDRC, PINC, 3);
+_CJKIT_FAST_PIN(18, PORTC, DDRC, PINC, 4);
+_CJKIT_FAST_PIN(19, PORTC, DDRC, PINC, 5);
+#elif defined(__AVR_ATmega4809__) && defined(ARDUINO_AVR_NANO_EVERY)
+// virtual ports are in the bit-addressable I/O space
+_CJKIT_FAST_PIN(2, VPORTA.OUT, VPORTA.DIR, VPORTA.IN, 0);
+_CJKIT_FAST_PIN(3, VPORTF.OUT, VPORTF.DIR, VPORTF.IN, 5);
+_CJKIT_FAST_PIN(4, VPORTC.OUT, VPORTC.DIR, VPORTC.IN, 6);
+_CJKIT_FAST_PIN(5, VPORTB.OUT, VPORTB.DIR, VPORTB.IN, 2);
+_CJKIT_FAST_PIN(6, VPORTF.OUT, VPORTF.DIR, VPORTF.IN, 4);
+_CJKIT_FAST_PIN(7, VPORTA.OUT, VPORTA.DIR, VPORTA.IN, 1);
+_CJKIT_FAST_PIN(8, VPORTE.OUT, VPORTE.DIR, VPORTE.IN, 3);
+_CJKIT_FAST_PIN(9, VPORTB.OUT, VPORTB.DIR, VPORTB.IN, 0);
+_CJKIT_FAST_PIN(10, VPORTB.OUT, VPORTB.DIR, VPORTB.IN, 1);
+_CJKIT_FAST_PIN(11, VPORTE.OUT, VPORTE.DIR, VPORTE.IN, 0);
+_CJKIT_FAST_PIN(12, VPORTE.OUT, VPORTE.DIR, VPORTE.IN, 1);
+_CJKIT_FAST_PIN(13, VPORTE.OUT, VPORTE.DIR, VPORTE.IN, 2);
+#endif
+
+#undef _CJKIT_FAST_PIN
+
+/// Arduino's built-in LED.
+typedef FastPin<LED_BUILTIN> BuiltinLedPin;
+
+/// (Active) buzzer pin (positive terminal).
+typedef FastPin<BUZZER_PIN> BuzzerPin;
+
+#if CJKIT_VERSION == 2
+/// "Arduino PCB" D1 LED pin.
+typedef FastPin<LED_D1_PIN> LedD1Pin;
+
+/// "Arduino PCB" D2 LED pin.
+typedef FastPin<LED_D2_PIN> LedD2Pin;
+
+/// "Arduino PCB" D3 LED pin.
+typedef FastPin<LED_D3_PIN> LedD3Pin;
+
+/// "Arduino PCB" D4 LED pin.
+typedef FastPin<LED_D4_PIN> LedD4Pin;
+#endif
+} // namespace CJKit
+
+#endif
@@ -0,0 +1,314 @@
+#ifndef _CJKIT_FLIGHT_H
+#define _CJKIT_FLIGHT_H
+
+#include <math.h>
+#include <stdint.h>
+
+namespace CJKit {
+
+/// Flight phases tracked by FlightPhaseDetector, in the order they happen.
+enum class FlightPhase : uint8_t { PAD, ASCENT, DESCENT, LANDED };
+
+/// Flight events reported by FlightPhaseDetector (one per phase transition).
+enum class FlightEvent : uint8_t { LAUNCH, APOGEE, LANDING };
+
+/// Number of distinct FlightEvent values.
+const uint8_t FLIGHT_EVENT_COUNT = 3;
+
+/**
+ * Flight event callback type: a function that receives the detected event and
+ * the time (in milliseconds, as given to the detector) of the sample that
+ * triggered it.
+ *
+ * Callbacks run synchronously inside the sample methods of
+ * FlightPhaseDetector, so they must be fast (e.g. switch a mode, set a pin).
+ */
+typedef void(FlightEventCallback)(FlightEvent, unsigned long);
+
+/**
+ * Thresholds used by FlightPhaseDetector.
+ *
+ * Each transition requires a number of consecutive confirming samples
+ * (hysteresis), so the detection latency is roughly that number of samples:
+ * feed the detector as often as possible to detect events early.
+ */
+struct FlightDetectorConfig {
+  /// Samples averaged to establish the ground reference.
+  uint8_t groundSamples = 8;
+
+  /// Height above ground (m) that counts as launched.
+  float launchHeightM = 10.0f;
+
+  /// Consecutive samples above launchHeightM needed to detect launch.
+  uint8_t launchConfirmSamples = 3;
+
+  /// Drop below the highest altitude (m) that counts as descending.
+  float apogeeDropM = 2.0f;
+
+  /// Consecutive samples below the apogee drop needed to detect apogee.
+  uint8_t apogeeConfirmSamples = 3;
+
+  /// Maximum altitude variation (m) while considered landed.
+  float landingToleranceM = 2.0f;
+
+  /// Time (ms) the altitude must stay within landingToleranceM to land.
+  unsigned long landingStableMs = 5000;
+
+  /// Time (ms) without pressure samples after which GPS samples are used.
+  unsigned long pressureTimeoutMs = 2000;
+};
+
+/**
+ * Flight phase state machine (launch, apogee and landing detection).
+ *
+ * The detector consumes pressure samples (e.g. from Pressure::readPressurePa)
+ * and, optionally, GPS altitude samples (e.g. from Gps::altitudeM and
+ * Gps::altitudeValid, once per Gps::altitudeUpdated) as soon as they are
+ * available, and calls the registered callbacks the moment a transition is
+ * confirmed. Call it from CJKit::xdelay's idle task to sample during delays
+ * instead of once per loop iteration.
+ *
+ * The first FlightDetectorConfig::groundSamples samples of each source define
+ * its ground reference, so the detector should be (re)started with reset while
+ * on the launch pad. The barometer is the primary source: GPS samples are only
+ * used while no pressure samples arrive for
+ * FlightDetectorConfig::pressureTimeoutMs. When the source changes, the new
+ * source's heights are offset to continue from the last height of the previous
+ * one, so switching does not trigger events by itself.
+ *
+ * The detector does not read the clock nor depend on the Arduino environment,
+ * which allows replaying recorded flights through it on a computer to tune the
+ * thresholds (see extras/test/flight_replay.cpp).
+ */
+class FlightPhaseDetector {
+private:
+  FlightDetectorConfig _config;
+  FlightEventCallback *_callbacks[FLIGHT_EVENT_COUNT] = {nullptr};
+
+  FlightPhase _phase = FlightPhase::PAD;
+
+  /// Sum of pressure samples (Pa) until the ground reference is established.
+  int32_t _groundPressureSum = 0;
+  uint8_t _groundPressureCount = 0;
+  float _groundPressurePa = 0;
+
+  /// Sum of GPS altitudes (m) until the ground reference is established.
+  float _groundGpsSum = 0;
+  uint8_t _groundGpsCount = 0;
+  float _groundGpsAltitudeM = 0;
+
+  bool _hasPressure = false;
+  unsigned long _lastPressureMs = 0;
+
+  /// Source of the latest height, and offsets that keep heights continuous
+  /// across source changes.
+  enum class _Source : uint8_t { NONE, PRESSURE, GPS };
+  _Source _source = _Source::NONE;
+  float _pressureOffsetM = 0;
+  float _gpsOffsetM = 0;
+
+  float _heightM = 0;
+  uint8_t _confirmCount = 0;
+
+  float _maxHeightM = 0;
+  unsigned long _maxHeightMs = 0;
+
+  /// Reference for landing detection: altitude and time it was first seen.
+  float _restHeightM = 0;
+  unsigned long _restSinceMs = 0;
+
+  unsigned long _eventMs[FLIGHT_EVENT_COUNT] = {0};
+
+  void _fire(FlightEvent event, FlightPhase next, unsigned long timeMs) {
+    _phase = next;
+    _confirmCount = 0;
+    _eventMs[(uint8_t)event] = timeMs;
+
+    FlightEventCallback *cb = _callbacks[(uint8_t)event];
+    if (cb != nullptr) {
+      cb(event, timeMs);
+    }
+  }
+
+  void _update(_Source source, float rawHeightM, unsigned long timeMs) {
+    float &offsetM =
+        source == _Source::PRESSURE ? _pressureOffsetM : _gpsOffsetM;
+    if (_source != source && _source != _Source::NONE) {
+      offsetM = _heightM - rawHeightM;
+    }
+    _source = source;
+
+    float heightM = rawHeightM + offsetM;
+    _heightM = heightM;
+
+    switch (_phase) {
+    case FlightPhase::PAD:
+      if (heightM < _config.launchHeightM) {
+        _confirmCount = 0;
+      } else if (++_confirmCount >= _config.launchConfirmSamples) {
+        _maxHeightM = heightM;
+        _maxHeightMs = timeMs;
+        _fire(FlightEvent::LAUNCH, FlightPhase::ASCENT, timeMs);
+      }
+      break;
+
+    case FlightPhase::ASCENT:
+      if (heightM > _maxHeightM) {
+        _maxHeightM = heightM;
+        _maxHeightMs = timeMs;
+        _confirmCount = 0;
+      } else if (heightM > _maxHeightM - _config.apogeeDropM) {
+        _confirmCount = 0;
+      } else if (++_confirmCount >= _config.apogeeConfirmSamples) {
+        _restHeightM = heightM;
+        _restSinceMs = timeMs;
+        _fire(FlightEvent::APOGEE, FlightPhase::DESCENT, timeMs);
+      }
+      break;
+
+    case FlightPhase::DESCENT:
+      if (fabs(heightM - _restHeightM) > _config.landingToleranceM) {
+        _restHeightM = heightM;
+        _restSinceMs = timeMs;
+      } else if (timeMs - _restSinceMs >= _config.landingStableMs) {
+        _fire(FlightEvent::LANDING, FlightPhase::LANDED, timeMs);
+      }
+      break;
+
+    case FlightPhase::LANDED:
+      break;
+    }
+  }
+
+public:
+  /**
+   * Construct a new flight phase detector.
+   *
+   * @param config - Detection thresholds.
+   */
+  FlightPhaseDetector(FlightDetectorConfig const &config = {})
+      : _config(config) {}
+
+  /**
+   * Restart detection from the launch pad, discarding the ground references.
+   * Registered callbacks are kept.
+   */
+  void reset(void) {
+    _phase = FlightPhase::PAD;
+    _groundPressureSum = 0;
+    _groundPressureCount = 0;
+    _groundGpsSum = 0;
+    _groundGpsCount = 0;
+    _hasPressure = false;
+    _source = _Source::NONE;
+    _pressureOffsetM = 0;
+    _gpsOffsetM = 0;
+    _heightM = 0;
+    _confirmCount = 0;
+    _maxHeightM = 0;
+    _maxHeightMs = 0;
+    for (uint8_t i = 0; i < FLIGHT_EVENT_COUNT; i++) {
+      _eventMs[i] = 0;
+    }
+  }
+
+  /**
+   * Set the callback for a flight event.
+   *
+   * @param event - The event that triggers the callback.
+   * @param cb - The new callback (nullptr to clear it).
+   * @returns The previous callback (nullptr if not set).
+   */
+  FlightEventCallback *setEventCallback(FlightEvent event,
+                                        FlightEventCallback *cb) {
+    FlightEventCallback *old = _callbacks[(uint8_t)event];
+    _callbacks[(uint8_t)event] = cb;
+    return old;
+  }
+
+  /**
+   * Feed a new pressure sample.
+   *
+   * @param pressurePa - Measured pressure in Pa.
+   * @param timeMs - Time of the measurement in ms (e.g. millis()).
+   */
+  void addPressureSample(int32_t pressurePa, unsigned long timeMs) {
+    _hasPressure = true;
+    _lastPressureMs = timeMs;
+
+    if (_groundPressureCount < _config.groundSamples) {
+      _groundPressureSum += pressurePa;
+      _groundPressureCount++;
+      _groundPressurePa = (float)_groundPressureSum / _groundPressureCount;
+      return;
+    }
+
+    // international barometric formula, relative to the ground reference
+    float heightM =
+        44330.0f * (1.0f - pow(pressurePa / _groundPressurePa, 0.1903f));
+    _update(_Source::PRESSURE, heightM, timeMs);
+  }
+
+  /**
+   * Feed a new GPS altitude sample. Ignored while pressure samples are being
+   * received, and when the GPS has no fix (invalid samples).
+   *
+   * Only feed each GPS reading once (e.g. when Gps::altitudeUpdated, which
+   * must be checked before calling Gps::altitudeM): repeated readings count
+   * as several samples towards confirmations, and the altitude a GPS keeps
+   * reporting after losing its fix looks like a landing.
+   *
+   * @param altitudeM - Altitude in m (e.g. Gps::altitudeM).
+   * @param valid - True if the GPS has an altitude fix (e.g.
+   * Gps::altitudeValid). GPS devices report 0 before a fix.
+   * @param timeMs - Time of the measurement in ms (e.g. millis()).
+   */
+  void addGpsAltitudeSample(float altitudeM, bool valid,
+                            unsigned long timeMs) {
+    if (!valid) {
+      return;
+    }
+
+    if (_groundGpsCount < _config.groundSamples) {
+      _groundGpsSum += altitudeM;
+      _groundGpsCount++;
+      _groundGpsAltitudeM = _groundGpsSum / _groundGpsCount;
+      return;
+    }
+
+    if (_hasPressure && timeMs - _lastPressureMs < _config.pressureTimeoutMs) {
+      return;
+    }
+
+    _update(_Source::GPS, altitudeM - _groundGpsAltitudeM, timeMs);
+  }
+
+  /// Current flight phase.
+  FlightPhase phase(void) const { return _phase; }
+
+  /// Latest height above the ground reference in m.
+  float heightM(void) const { return _heightM; }
+
+  /// Highest height above the ground reference (m) since launch.
+  float maxHeightM(void) const { return _maxHeightM; }
+
+  /// Time (ms) of the sample with the highest height since launch.
+  unsigned long maxHeightTimeMs(void) const { return _maxHeightMs; }
+
+  /**
+   * Time (ms) at which an event was detected.
+   * Comparing the APOGEE time with maxHeightTimeMs gives the apogee detection
+   * latency.
+   *
+   * @param event - The event.
+   * @returns Time of the sample that triggered the event, or 0 if it did not
+   * happen yet.
+   */
+  unsigned long eventTimeMs(FlightEvent event) const {
+    return _eventMs[(uint8_t)event];
+  }
+};
+
+} // namespace CJKit
+
+#endif
@@ -39,6 +39,9 @@ public:
   /// Maximum bytes processed per batch in Gps::parsePending.
   const uint8_t PARSE_MAX_BATCH_SIZE = 128;
 
+  /// Age (ms) after which the last received altitude is no longer valid.
+  static const uint16_t ALTITUDE_MAX_AGE_MS = 2000;
+
   /**
    * Construct a new Gps interface from an existing stream of incoming NMEA
    * messages.
@@ -111,6 +114,20 @@ public:
    */
   uint32_t altitudeAge(void) { return _parser.altitude.age(); }
 
+  /**
+   * True if an altitude was received in the last Gps::ALTITUDE_MAX_AGE_MS.
+   * After losing its fix, the GPS keeps reporting the last altitude.
+   */
+  bool altitudeValid(void) {
+    return _parser.altitude.isValid() &&
+           _parser.altitude.age() < ALTITUDE_MAX_AGE_MS;
+  }
+
+  /**
+   * True if a new altitude was received since the last call to altitudeM.
+   */
+  bool altitudeUpdated(void) { return _parser.altitude.isUpdated(); }
+
   /**
    * Read-only reference to the internal parsing library instance.
    *
@@ -0,0 +1,118 @@
+#ifndef _CJKIT_MESSAGES_H
+#define _CJKIT_MESSAGES_H
+
+#include <Arduino.h>
+
+namespace CJKit {
+/// Size of the header at the start of each packet in message mode (a packet
+/// counter used to detect lost fragments).
+static const uint8_t MESSAGE_PACKET_HEADER_SIZE = 1;
+
+/// @private Chunk header: first chunk of a message.
+static const uint8_t MESSAGE_CHUNK_START = 0x80;
+/// @private Chunk header: last chunk of a message.
+static const uint8_t MESSAGE_CHUNK_END = 0x40;
+/// @private Chunk header: chunk data length.
+static const uint8_t MESSAGE_CHUNK_LEN_MASK = 0x3F;
+
+/**
+ * Message handler type: a function that receives a complete message and its
+ * length in bytes. The message is only valid during the call.
+ */
+typedef void(MessageHandler)(uint8_t const *, size_t);
+
+/**
+ * Rebuilds the messages sent with BufferedPrint::beginMessage and
+ * BufferedPrint::endMessage (e.g. over StreamedRadio) from received packets.
+ *
+ * Packets must be passed to MessageReassembler::feed in the order they were
+ * received. Each complete message is delivered to the handler; messages that
+ * are missing a fragment or are longer than MAX_MESSAGE_SIZE are dropped.
+ * Reordered packets count as missing fragments. ReliableRadio::receive
+ * returns packets in the order they were sent, so over ReliableRadio messages
+ * are only dropped when the sender gives up on one of their packets.
+ */
+template <size_t MAX_MESSAGE_SIZE> class MessageReassembler {
+private:
+  MessageHandler *_handler;
+
+  uint8_t _message[MAX_MESSAGE_SIZE];
+  size_t _len = 0;
+  bool _assembling = false;
+
+  uint8_t _nextCounter = 0;
+  uint32_t _dropped = 0;
+
+  void _drop(void) {
+    if (_assembling) {
+      _assembling = false;
+      _dropped++;
+    }
+  }
+
+public:
+  /**
+   * Construct a new message reassembler.
+   *
+   * @param handler - Function called with each complete message.
+   */
+  MessageReassembler(MessageHandler *handler) : _handler(handler) {}
+
+  /**
+   * Process a received packet, calling the handler for each message it
+   * completes.
+   *
+   * @param packet - Packet payload (e.g. from StreamedRadio::receive).
+   * @param len - Size of the packet payload.
+   */
+  void feed(uint8_t const *packet, size_t len) {
+    if (len < MESSAGE_PACKET_HEADER_SIZE) {
+      return;
+    }
+
+    if (packet[0] != _nextCounter) {
+      _drop(); // missed a packet, which may have had part of this message
+    }
+    _nextCounter = packet[0] + 1;
+
+    size_t i = MESSAGE_PACKET_HEADER_SIZE;
+    while (i < len) {
+      uint8_t header = packet[i++];
+      size_t chunkLen = header & MESSAGE_CHUNK_LEN_MASK;
+      if (chunkLen > len - i) {
+        _drop(); // malformed packet
+        return;
+      }
+
+      if (header & MESSAGE_CHUNK_START) {
+        _drop();
+        _assembling = true;
+        _len = 0;
+      }
+
+      if (_assembling) {
+        if (_len + chunkLen > MAX_MESSAGE_SIZE) {
+          _drop();
+        } else {
+          memcpy(_message + _len, packet + i, chunkLen);
+          _len += chunkLen;
+
+          if (header & MESSAGE_CHUNK_END) {
+            _assembling = false;
+            _handler(_message, _len);
+          }
+        }
+      }
+
+      i += chunkLen;
+    }
+  }
+
+  /**
+   * Number of messages dropped because of missing fragments or size.
+   */
+  uint32_t droppedMessages(void) const { return _dropped; }
+};
+} // namespace CJKit
+
+#endif
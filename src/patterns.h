@@ -0,0 +1,151 @@
+#ifndef _CJKIT_PATTERNS_H
+#define _CJKIT_PATTERNS_H
+
+#include "fast_gpio.h"
+#include <Arduino.h>
+
+namespace CJKit {
+/**
+ * Non-blocking on/off pattern player for LEDs and (active) buzzers.
+ *
+ * Plays blink codes (e.g. 3 blinks, pause, repeat) and arbitrary on/off
+ * sequences on a pin given as a FastPin type (e.g. BuzzerPin or LedD1Pin).
+ * Nothing happens in the background: PatternPlayer::update must be called
+ * often, e.g. from CJKit::xdelay's idle task or a timer, and it only touches
+ * the pin when a step ends. Patterns are as precise as those calls: the idle
+ * task only runs about every XDELAY_MAX_INTERMEDIATE_DELAY_MS during xdelay,
+ * so steps played from it should be multiples of that (the defaults of
+ * PatternPlayer::playCode are). Shorter steps need a timer.
+ *
+ * When calling update from an interrupt, disable interrupts around calls to the
+ * other methods.
+ */
+template <class PIN> class PatternPlayer {
+private:
+  /// Step durations in ms (nullptr when playing a blink code).
+  uint16_t const *_steps = nullptr;
+  uint8_t _stepCount = 0;
+
+  /// Blink code parameters.
+  uint16_t _onMs = 0;
+  uint16_t _offMs = 0;
+  uint16_t _pauseMs = 0;
+
+  bool _repeat = false;
+  bool _playing = false;
+  uint8_t _step = 0;
+  unsigned long _stepStartMs = 0;
+  uint16_t _stepMs = 0;
+
+  void _startStep(unsigned long nowMs) {
+    _stepStartMs = nowMs;
+    if (_steps != nullptr) {
+      _stepMs = _steps[_step];
+    } else if (_step == _stepCount - 1) {
+      _stepMs = _pauseMs;
+    } else {
+      _stepMs = (_step % 2 == 0) ? _onMs : _offMs;
+    }
+
+    PIN::write(_step % 2 == 0);
+  }
+
+  void _start(bool repeat) {
+    _repeat = repeat;
+    _step = 0;
+    _playing = _stepCount > 0;
+    if (_playing) {
+      _startStep(millis());
+    } else {
+      PIN::low();
+    }
+  }
+
+public:
+  /**
+   * Configure the pin as an output and turn it off.
+   * Must be called before any other method.
+   */
+  void begin(void) {
+    PIN::setOutput();
+    PIN::low();
+  }
+
+  /**
+   * Play a sequence of on/off steps, starting with on.
+   *
+   * @param steps - Duration of each step in ms. Must remain valid while it
+   * plays (e.g. a global or static array).
+   * @param count - Number of steps.
+   * @param repeat - True to repeat the sequence until stopped.
+   */
+  void play(uint16_t const *steps, uint8_t count, bool repeat = false) {
+    _steps = steps;
+    _stepCount = count;
+    _start(repeat);
+  }
+
+  /**
+   * Play a blink code: a number of short pulses followed by a pause.
+   *
+   * @param pulses - Number of pulses.
+   * @param repeat - True to repeat the code until stopped.
+   * @param onMs - Duration of each pulse.
+   * @param offMs - Time between pulses.
+   * @param pauseMs - Time after the last pulse.
+   */
+  void playCode(uint8_t pulses, bool repeat = true, uint16_t onMs = 250,
+                uint16_t offMs = 250, uint16_t pauseMs = 1500) {
+    _steps = nullptr;
+    _stepCount = (pulses > 127 ? 127 : pulses) * 2;
+    _onMs = onMs;
+    _offMs = offMs;
+    _pauseMs = pauseMs;
+    _start(repeat);
+  }
+
+  /**
+   * Turn the pin on until stopped.
+   */
+  void on(void) {
+    _playing = false;
+    PIN::high();
+  }
+
+  /**
+   * Stop playing and turn the pin off.
+   */
+  void stop(void) {
+    _playing = false;
+    PIN::low();
+  }
+
+  /**
+   * True while a pattern is playing.
+   */
+  bool playing(void) const { return _playing; }
+
+  /**
+   * Advance the pattern. Cheap when the current step is not over yet.
+   *
+   * @param nowMs - Current time in ms.
+   */
+  void update(unsigned long nowMs) {
+    if (!_playing || nowMs - _stepStartMs < _stepMs) {
+      return;
+    }
+
+    if (++_step >= _stepCount) {
+      if (!_repeat) {
+        stop();
+        return;
+      }
+      _step = 0;
+    }
+    _startStep(nowMs);
+  }
+  void update(void) { update(millis()); }
+};
+} // namespace CJKit
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef _CJKIT_RADIO_H
 #define _CJKIT_RADIO_H
 
+#include "airtime.h"
 #include "base.h"
 #include "buffered_print.h"
 #include <Arduino.h>
@@ -22,28 +23,17 @@ namespace CJKit {
 /// Maximum payload size in a radio packet.
 static const uint8_t RADIO_PAYLOAD_MAX_SIZE = 61;
 
+#if CJKIT_VERSION != 0
+/// Transmit power (dBm) set by begin.
+static const int8_t RADIO_DEFAULT_POWER_DBM = 5;
+#endif
+
 /**
- * CanSat Júnior's Radio driver with Print-like interface.
- *
- * This class allows [Print::print]-ing to the radio with the usual Arduino
- * Print methods (same as in Serial), by buffering output (see [BufferedPrint])
- * up to the maximum size of an RFM69HCW packet. Users must call [begin] before
- * any other method, and should call [setFrequency] with their assigned telemtry
- * frequency.
- *
- * To minimize the effects of interference, users should keep the size of each
- * transmission under [MAX_BUFFER_SIZE] and call [flush] between transmissions,
- * ensuring either the full message is received or nothing is received at all
- * (corrupted messages are detected and discarded automatically by the radio
- * hardware).
- *
- * To support use cases more advanced than what this library allows while
- * retaining the convenience of Print methods, users create a new class
- * extending [BufferedPrint] with the desired functionality.
+ * RFM69 radio device shared by the radio drivers (see StreamedRadio and
+ * ReliableRadio). Not meant to be used directly.
  */
-template <uint8_t OWN_NODE_ID = 0, uint8_t DEST_NODE_ID = 1,
-          uint8_t NET_ID = 100>
-class StreamedRadio : public BufferedPrint<RADIO_PAYLOAD_MAX_SIZE> {
+template <uint8_t OWN_NODE_ID, uint8_t DEST_NODE_ID, uint8_t NET_ID>
+class RadioDevice {
 public:
   /// Radio encryption key size (in bytes).
   static const uint8_t ENCRYPTION_KEY_SIZE =
@@ -51,21 +41,42 @@ public:
           // CHANGE
 
 private:
-  _CJKIT_RADIO_CLASS _radio;
+  AirtimeBudget *_airtime = nullptr;
+  uint32_t _packetsThrottled = 0;
+  bool _encrypted = false;
   static const uint8_t RADIO_FREQ_BAND = RF69_433MHZ;
 
 protected:
-  void write_unbuffered(uint8_t const *buf, int size) final {
-    // TODO: be smart about logging
-    Serial.print("saída rádio: ");
-    Serial.write(buf, size);
-    Serial.println();
-    _radio.send(DEST_NODE_ID, buf, size);
+  _CJKIT_RADIO_CLASS _radio;
+
+  /**
+   * Sends a packet, unless it does not fit in the airtime budget.
+   * @param retry - True if the packet was refused before (see
+   * AirtimeBudget::acquire).
+   * @returns True if the packet was sent.
+   */
+  bool _send(void const *buf, uint8_t len, bool retry = false) {
+    if (_airtime == nullptr) {
+      _radio.send(DEST_NODE_ID, buf, len);
+      return true;
+    }
+
+    // timing send() would also count the wait for a free channel and the SPI
+    // transfer, so use the time the packet takes on air
+    uint32_t airtimeUs = AirtimeBudget::packetAirtimeUs(len, _encrypted);
+    if (!_airtime->acquire(airtimeUs, millis(), retry)) {
+      if (!retry) {
+        _packetsThrottled++;
+      }
+      return false;
+    }
+    _radio.send(DEST_NODE_ID, buf, len);
+    return true;
   }
 
 public:
   /**
-   * Create radio driver.
+   * Create radio device.
    *
    * Default parameters correspond to standard kit configuration.
    *
@@ -76,9 +87,9 @@ public:
    * @param spi - SPI interface where radio is connected. Use nullptr for
    * default Arduino SPI interface.
    */
-  StreamedRadio(uint8_t slaveSelectPin = RADIO_SS_PIN,
-                uint8_t interruptPin = RADIO_IRQ_PIN, bool isRFM69HW = false,
-                SPIClass *spi = nullptr)
+  RadioDevice(uint8_t slaveSelectPin = RADIO_SS_PIN,
+              uint8_t interruptPin = RADIO_IRQ_PIN, bool isRFM69HW = false,
+              SPIClass *spi = nullptr)
       : _radio(slaveSelectPin, interruptPin, isRFM69HW, spi) {}
 
   /**
@@ -96,13 +107,32 @@ public:
     }
     _radio.setHighPower();
     _radio.encrypt(nullptr);
+    _encrypted = false;
 #if CJKIT_VERSION != 0 && CJKIT_VERSION <= 2
-    _radio.setPowerDBm(5);
+    _radio.setPowerDBm(RADIO_DEFAULT_POWER_DBM);
 #endif
 
     return true;
   }
 
+  /**
+   * Limit transmissions to an airtime budget (nullptr to remove the limit).
+   *
+   * The airtime of each packet (see AirtimeBudget::packetAirtimeUs) is
+   * recorded in the budget, and packets that do not fit in it are not sent:
+   * they are dropped (see packetsThrottled), or retried later by ReliableRadio.
+   * Use AirtimeBudget::keepSample to send less often before that happens.
+   *
+   * @param budget - Airtime budget, which must outlive its use by the radio.
+   */
+  void setAirtimeBudget(AirtimeBudget *budget) { _airtime = budget; }
+
+  /**
+   * Number of packets refused by the airtime budget (see setAirtimeBudget).
+   * Packets retried by ReliableRadio count once.
+   */
+  uint32_t packetsThrottled(void) const { return _packetsThrottled; }
+
   /**
    * Set radio operating frequency (for transmission and reception).
    *
@@ -119,7 +149,8 @@ public:
    * @param key - Encryption key.
    */
   void setEncryptionKey(uint8_t const key[ENCRYPTION_KEY_SIZE]) {
-    _radio.encrypt((char const *)&key[0]);
+    _radio.encrypt((char const *)key);
+    _encrypted = key != nullptr;
   }
 
   /**
@@ -128,6 +159,85 @@ public:
    */
   _CJKIT_RADIO_CLASS &internalRadio() { return _radio; }
 };
+
+/**
+ * CanSat Júnior's Radio driver with Print-like interface.
+ *
+ * This class allows [Print::print]-ing to the radio with the usual Arduino
+ * Print methods (same as in Serial), by buffering output (see [BufferedPrint])
+ * up to the maximum size of an RFM69HCW packet. Users must call [begin] before
+ * any other method, and should call [setFrequency] with their assigned telemtry
+ * frequency.
+ *
+ * To minimize the effects of interference, users should keep the size of each
+ * transmission under [MAX_BUFFER_SIZE] and call [flush] between transmissions,
+ * ensuring either the full message is received or nothing is received at all
+ * (corrupted messages are detected and discarded automatically by the radio
+ * hardware). Alternatively, users can delimit each message with
+ * [beginMessage] and [endMessage] (see [BufferedPrint]): several messages are
+ * then packed in each packet without ever being split, messages over the
+ * packet size are fragmented, and receivers rebuild them with
+ * [MessageReassembler], dropping the incomplete ones. [flush] is then only
+ * needed to send pending messages right away.
+ *
+ * Packets are sent once, without confirmation: see [ReliableRadio] for
+ * acknowledged delivery.
+ *
+ * To support use cases more advanced than what this library allows while
+ * retaining the convenience of Print methods, users create a new class
+ * extending [BufferedPrint] with the desired functionality.
+ */
+template <uint8_t OWN_NODE_ID = 0, uint8_t DEST_NODE_ID = 1,
+          uint8_t NET_ID = 100>
+class StreamedRadio : public BufferedPrint<RADIO_PAYLOAD_MAX_SIZE>,
+                      public RadioDevice<OWN_NODE_ID, DEST_NODE_ID, NET_ID> {
+protected:
+  void write_unbuffered(uint8_t const *buf, int size) final {
+    // TODO: be smart about logging
+    if (!this->messageMode()) { // message mode packets are not plain text
+      Serial.print("saída rádio: ");
+      Serial.write(buf, size);
+      Serial.println();
+    }
+    this->_send(buf, size);
+  }
+
+public:
+  /**
+   * Create radio driver.
+   *
+   * Default parameters correspond to standard kit configuration.
+   *
+   * @param slaveSelectPin - Arduino digital pin connected to radio's NSS pin.
+   * @param interruptPin - Arduino digital pin with interrupt capabilities
+   * connected to radio's DIO0 pin.
+   * @param isRFM69HW - True if radio is a RFM69HW, false otherwise.
+   * @param spi - SPI interface where radio is connected. Use nullptr for
+   * default Arduino SPI interface.
+   */
+  StreamedRadio(uint8_t slaveSelectPin = RADIO_SS_PIN,
+                uint8_t interruptPin = RADIO_IRQ_PIN, bool isRFM69HW = false,
+                SPIClass *spi = nullptr)
+      : RadioDevice<OWN_NODE_ID, DEST_NODE_ID, NET_ID>(
+            slaveSelectPin, interruptPin, isRFM69HW, spi) {}
+
+  /**
+   * Receive a packet, if one arrived.
+   *
+   * @param buf - Where to store the packet's payload.
+   * @param bufSize - Size of buf. Longer payloads are truncated.
+   * @returns Size of the payload stored in buf, 0 if no packet was received.
+   */
+  uint8_t receive(uint8_t *buf, uint8_t bufSize) {
+    if (!this->_radio.receiveDone()) {
+      return 0;
+    }
+
+    uint8_t len = min(this->_radio.DATALEN, bufSize);
+    memcpy(buf, this->_radio.DATA, len);
+    return len;
+  }
+};
 } // namespace CJKit
 
 #endif
@@ -0,0 +1,649 @@
+#ifndef _CJKIT_RELIABLE_RADIO_H
+#define _CJKIT_RELIABLE_RADIO_H
+
+#include "radio.h"
+
+namespace CJKit {
+/// Size of the frame header prepended to each packet by ReliableRadio: type,
+/// sequence number, the oldest sequence number not given up on and the
+/// sender's session number.
+static const uint8_t RADIO_RELIABLE_HEADER_SIZE = 4;
+
+/// Maximum number of unacknowledged packets in ReliableRadio.
+static const uint8_t RADIO_RELIABLE_MAX_WINDOW_SIZE = 32;
+
+/// @private ReliableRadio frame types (first header byte).
+static const uint8_t RADIO_FRAME_DATA = 0x01;
+static const uint8_t RADIO_FRAME_ACK = 0x02;
+
+/// @private ACK frame: type, base sequence number, 32-bit mask, RSSI, session
+/// number of the acknowledged frames.
+static const uint8_t RADIO_ACK_FRAME_SIZE = 8;
+
+/**
+ * Link statistics collected by ReliableRadio.
+ */
+struct RadioLinkStats {
+  /// Data packets sent at least once (not counting retransmissions).
+  uint32_t packetsSent = 0;
+
+  /// Data packets acknowledged by the receiver.
+  uint32_t packetsAcked = 0;
+
+  /// Data packets given up on (retries exhausted or evicted from the window).
+  uint32_t packetsLost = 0;
+
+  /// Data packet retransmissions.
+  uint32_t retransmissions = 0;
+
+  /// Transmissions held back because the airtime budget was exhausted (data
+  /// packets are retried later and count once per held back transmission).
+  uint32_t packetsThrottled = 0;
+
+  /// RSSI (dBm) of our packets as measured by the receiver, from the last ACK.
+  int16_t lastRssiDBm = 0;
+
+  /// Running average of lastRssiDBm.
+  float avgRssiDBm = 0;
+
+  /// Running average of the fraction of transmissions (including
+  /// retransmissions) that were not acknowledged in time (0 to 1).
+  float lossRate = 0;
+};
+
+/**
+ * CanSat Júnior's Radio driver with acknowledged delivery and Print-like
+ * interface.
+ *
+ * Works like StreamedRadio, but each packet carries a sequence number and is
+ * kept (in a static window of WINDOW_SIZE packets) until the receiver
+ * acknowledges it, being retransmitted if no ACK arrives in time. Both nodes
+ * must use ReliableRadio, the sender must call [poll] often (e.g. from
+ * CJKit::xdelay's idle task) to process ACKs and retransmissions, and the
+ * receiver must call [receive] to get packets and send ACKs. Packets are never
+ * waited for: when the window is full the oldest unacknowledged packet is
+ * given up on. Each packet carries [RADIO_RELIABLE_HEADER_SIZE] bytes of
+ * header, including a session number picked by [begin] which tells the
+ * receiver that the sender restarted.
+ *
+ * Packets are delivered by [receive] in the order they were sent: packets
+ * received after a missing one are held in the window until it is
+ * retransmitted, or skipped once the sender gives up on it. Packets that do
+ * not fit in the window are not acknowledged, so the sender retransmits them
+ * later. This keeps messages (see [BufferedPrint::beginMessage]) whole for
+ * [MessageReassembler].
+ *
+ * The window takes about WINDOW_SIZE * 66 bytes of RAM, shared by sent
+ * packets waiting for an ACK and received packets waiting to be delivered.
+ */
+template <uint8_t OWN_NODE_ID = 0, uint8_t DEST_NODE_ID = 1,
+          uint8_t NET_ID = 100, uint8_t WINDOW_SIZE = 4>
+class ReliableRadio
+    : public BufferedPrint<RADIO_PAYLOAD_MAX_SIZE - RADIO_RELIABLE_HEADER_SIZE>,
+      public RadioDevice<OWN_NODE_ID, DEST_NODE_ID, NET_ID> {
+  static_assert(WINDOW_SIZE > 0 &&
+                    WINDOW_SIZE <= RADIO_RELIABLE_MAX_WINDOW_SIZE,
+                "invalid reliable window size");
+
+  typedef RadioDevice<OWN_NODE_ID, DEST_NODE_ID, NET_ID> _Device;
+
+private:
+  /// Unacknowledged packet, or received packet held until the ones before it
+  /// are delivered (free when len is 0).
+  struct _Slot {
+    uint8_t len = 0;
+    bool held : 1;
+    /// Last (re)transmission held back by the airtime budget.
+    bool throttled : 1;
+    uint8_t tries;
+    unsigned long sentAtMs;
+    uint8_t frame[RADIO_PAYLOAD_MAX_SIZE];
+  };
+
+  _Slot _window[WINDOW_SIZE];
+  uint8_t _txNextSeq = 0;
+  uint8_t _txSession = 0;
+  unsigned long _retransmitTimeoutMs = 250;
+  uint8_t _maxRetries = 3;
+
+  /// Lowest sequence number not yet received, and received ones after it
+  /// (bit i is sequence number _rxBase + i).
+  uint8_t _rxBase = 0;
+  uint32_t _rxMask = 0;
+
+  /// Next sequence number to deliver, and the sequence number up to which
+  /// missing packets are skipped (the sender gave up on them).
+  uint8_t _rxNext = 0;
+  uint8_t _rxSkipTo = 0;
+  uint8_t _rxSession = 0;
+  bool _rxSynced = false;
+
+  RadioLinkStats _stats;
+
+#if CJKIT_VERSION != 0
+  bool _adaptivePower = false;
+  int8_t _txPowerDBm = RADIO_DEFAULT_POWER_DBM;
+  int8_t _targetRssiDBm = -80;
+  int8_t _minPowerDBm = -2;
+  int8_t _maxPowerDBm = RADIO_DEFAULT_POWER_DBM;
+  uint8_t _powerHoldCount = 0;
+
+  /// Transmission outcomes between transmit power adjustments.
+  static const uint8_t POWER_ADJUST_INTERVAL = 8;
+#endif
+
+  /// Sends a packet through the device, counting throttled packets.
+  bool _send(void const *buf, uint8_t len) {
+    if (!_Device::_send(buf, len)) {
+      _stats.packetsThrottled++;
+      return false;
+    }
+    return true;
+  }
+
+  /// Oldest sequence number waiting for an ACK (the next one if none).
+  uint8_t _txLow(void) const {
+    uint8_t low = _txNextSeq;
+    uint8_t lowAge = 0;
+    for (uint8_t i = 0; i < WINDOW_SIZE; i++) {
+      _Slot const &slot = _window[i];
+      uint8_t age = _txNextSeq - slot.frame[1];
+      if (slot.len != 0 && !slot.held && age > lowAge) {
+        low = slot.frame[1];
+        lowAge = age;
+      }
+    }
+    return low;
+  }
+
+  /**
+   * Sends an unacknowledged packet. Throttled packets are retried on the next
+   * call to [poll] (until the airtime budget allows them).
+   * @returns True if the packet was sent.
+   */
+  bool _transmit(_Slot &slot) {
+    slot.frame[2] = _txLow();
+    if (!_Device::_send(slot.frame, slot.len, slot.throttled)) {
+      if (!slot.throttled) {
+        slot.throttled = true;
+        _stats.packetsThrottled++;
+      }
+      return false;
+    }
+
+    slot.throttled = false;
+    slot.sentAtMs = millis();
+    slot.tries++;
+    return true;
+  }
+
+  /// Updates the loss rate with the outcome of a transmission.
+  void _recordTransmission(bool acked) {
+    if (acked) {
+      _stats.lossRate -= _stats.lossRate / 8;
+    } else {
+      _stats.lossRate += (1.0f - _stats.lossRate) / 8;
+    }
+    _adaptTxPower();
+  }
+
+  /// Records the outcome of a packet and frees its slot.
+  void _release(_Slot &slot, bool acked) {
+    slot.len = 0;
+    if (acked) {
+      _stats.packetsAcked++;
+    } else {
+      _stats.packetsLost++;
+    }
+
+    // a throttled transmission was not sent, or was already counted as lost
+    if (acked || (slot.tries > 0 && !slot.throttled)) {
+      _recordTransmission(acked);
+    }
+  }
+
+  /// Adjusts transmit power by 1dBm towards the target RSSI, raising it when
+  /// transmissions get lost. v0 kits use RFM69_ATC, which manages its own
+  /// power.
+  void _adaptTxPower(void) {
+#if CJKIT_VERSION != 0
+    if (!_adaptivePower || ++_powerHoldCount < POWER_ADJUST_INTERVAL) {
+      return;
+    }
+    _powerHoldCount = 0;
+
+    int8_t next = _txPowerDBm;
+    if (_stats.lossRate > 0.2f || _stats.avgRssiDBm < _targetRssiDBm - 5) {
+      next++;
+    } else if (_stats.lossRate < 0.05f &&
+               _stats.avgRssiDBm > _targetRssiDBm + 5) {
+      next--;
+    }
+    next = constrain(next, _minPowerDBm, _maxPowerDBm);
+
+    if (next != _txPowerDBm) {
+      _txPowerDBm = this->_radio.setPowerDBm(next);
+    }
+#endif
+  }
+
+  void _processAck(uint8_t const *frame) {
+    if (frame[7] != _txSession) {
+      return; // acknowledges frames sent before begin
+    }
+
+    uint8_t base = frame[1];
+    uint32_t mask = (uint32_t)frame[2] | ((uint32_t)frame[3] << 8) |
+                    ((uint32_t)frame[4] << 16) | ((uint32_t)frame[5] << 24);
+
+    _stats.lastRssiDBm = (int8_t)frame[6];
+    if (_stats.packetsAcked == 0) {
+      _stats.avgRssiDBm = _stats.lastRssiDBm;
+    } else {
+      _stats.avgRssiDBm += (_stats.lastRssiDBm - _stats.avgRssiDBm) / 8;
+    }
+
+    for (uint8_t i = 0; i < WINDOW_SIZE; i++) {
+      _Slot &slot = _window[i];
+      if (slot.len == 0 || slot.held) {
+        continue;
+      }
+
+      uint8_t d = slot.frame[1] - base;
+      if (d >= 128 || (d < 32 && (mask & (1UL << d)))) {
+        _release(slot, true);
+      }
+    }
+  }
+
+  /// Restarts reception from the given sequence number.
+  void _rxReset(uint8_t seq) {
+    _rxBase = seq;
+    _rxMask = 0;
+    _rxNext = seq;
+    _rxSkipTo = seq;
+    _rxSynced = true;
+    for (uint8_t i = 0; i < WINDOW_SIZE; i++) {
+      if (_window[i].held) {
+        _window[i].len = 0;
+        _window[i].held = false;
+      }
+    }
+  }
+
+  /// True if the frame with the given sequence number was received before.
+  bool _isReceived(uint8_t seq) const {
+    uint8_t d = seq - _rxBase;
+    return d >= 128 || (d < 32 && (_rxMask & (1UL << d)));
+  }
+
+  void _markReceived(uint8_t seq) {
+    uint8_t d = seq - _rxBase;
+    if (d < 32) {
+      _rxMask |= 1UL << d;
+    }
+    while (_rxMask & 1) {
+      _rxMask >>= 1;
+      _rxBase++;
+    }
+  }
+
+  /// Stops waiting for the frames before low, which the sender gave up on.
+  void _rxGiveUpBefore(uint8_t low) {
+    uint8_t d = low - _rxBase;
+    if (d != 0 && d < 128) {
+      _rxMask = d >= 32 ? 0 : _rxMask >> d;
+      _rxBase = low;
+      while (_rxMask & 1) {
+        _rxMask >>= 1;
+        _rxBase++;
+      }
+    }
+
+    d = low - _rxSkipTo;
+    if (d != 0 && d < 128) {
+      _rxSkipTo = low;
+    }
+  }
+
+  /**
+   * Skips the missing frames the sender gave up on.
+   * @returns The held frame to deliver next, if it was received.
+   */
+  _Slot *_rxSkipMissing(void) {
+    for (;;) {
+      for (uint8_t i = 0; i < WINDOW_SIZE; i++) {
+        _Slot &slot = _window[i];
+        if (slot.len != 0 && slot.held && slot.frame[1] == _rxNext) {
+          return &slot;
+        }
+      }
+
+      if (_rxNext == _rxSkipTo) {
+        return nullptr;
+      }
+      _rxNext++;
+    }
+  }
+
+  /// Copies the payload of the next frame in order to buf.
+  uint8_t _deliver(uint8_t *buf, uint8_t bufSize, uint8_t const *frame,
+                   uint8_t frameLen) {
+    if (_rxSkipTo == _rxNext) {
+      _rxSkipTo++;
+    }
+    _rxNext++;
+
+    uint8_t len =
+        min((uint8_t)(frameLen - RADIO_RELIABLE_HEADER_SIZE), bufSize);
+    memcpy(buf, frame + RADIO_RELIABLE_HEADER_SIZE, len);
+    return len;
+  }
+
+  void _sendAck(int16_t rssi) {
+    uint8_t ack[RADIO_ACK_FRAME_SIZE];
+    ack[0] = RADIO_FRAME_ACK;
+    ack[1] = _rxBase;
+    for (uint8_t i = 0; i < 4; i++) {
+      ack[2 + i] = (uint8_t)(_rxMask >> (8 * i));
+    }
+    ack[6] = (uint8_t)(int8_t)constrain(rssi, -128, 127);
+    ack[7] = _rxSession;
+    _send(ack, sizeof(ack));
+  }
+
+  /**
+   * Delivers or holds a received data frame, and acknowledges it. Frames are
+   * only delivered if deliver is set, otherwise they are held for [receive].
+   * @returns Size of the payload stored in buf, 0 if none was delivered.
+   */
+  uint8_t _processData(uint8_t *buf, uint8_t bufSize, uint8_t const *frame,
+                       uint8_t frameLen, int16_t rssi, bool deliver) {
+    uint8_t seq = frame[1];
+    uint8_t low = frame[2];
+    if (!_rxSynced || frame[3] != _rxSession) {
+      // first frame, or sender restarted
+      _rxReset(low);
+      _rxSession = frame[3];
+    }
+    _rxGiveUpBefore(low);
+    _rxSkipMissing();
+
+    uint8_t d = seq - _rxBase;
+    if (d >= 32 && d < 128) {
+      return 0; // not from the sender's window
+    }
+
+    // sending the ACK reuses the radio's receive buffer, deliver or hold first
+    uint8_t len = 0;
+    if (!_isReceived(seq)) {
+      uint8_t ahead = seq - _rxNext;
+      if (ahead == 0 && deliver) {
+        len = _deliver(buf, bufSize, frame, frameLen);
+      } else if (ahead < 128) {
+        _Slot *slot = nullptr;
+        for (uint8_t i = 0; i < WINDOW_SIZE && slot == nullptr; i++) {
+          if (_window[i].len == 0) {
+            slot = &_window[i];
+          }
+        }
+        if (slot == nullptr) {
+          return 0; // no room to hold it, wait for a retransmission
+        }
+
+        slot->held = true;
+        slot->len = frameLen;
+        memcpy(slot->frame, frame, frameLen);
+      }
+      _markReceived(seq);
+    }
+
+    _sendAck(rssi);
+    return len;
+  }
+
+  /**
+   * Processes a frame received by the radio, if any (see [_processData]).
+   * @returns Size of the payload stored in buf, 0 if none was delivered.
+   */
+  uint8_t _receiveFrame(uint8_t *buf, uint8_t bufSize, bool deliver) {
+    if (!this->_radio.receiveDone()) {
+      return 0;
+    }
+
+    if (this->_radio.SENDERID != DEST_NODE_ID || this->_radio.DATALEN < 2) {
+      return 0;
+    }
+
+    uint8_t type = this->_radio.DATA[0];
+    if (type == RADIO_FRAME_ACK &&
+        this->_radio.DATALEN == RADIO_ACK_FRAME_SIZE) {
+      _processAck(this->_radio.DATA);
+      return 0;
+    } else if (type != RADIO_FRAME_DATA ||
+               this->_radio.DATALEN < RADIO_RELIABLE_HEADER_SIZE) {
+      return 0;
+    }
+
+    return _processData(buf, bufSize, this->_radio.DATA, this->_radio.DATALEN,
+                        this->_radio.RSSI, deliver);
+  }
+
+  void _retransmitExpired(void) {
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < WINDOW_SIZE; i++) {
+      _Slot &slot = _window[i];
+      if (slot.len == 0 || slot.held) {
+        continue;
+      }
+
+      if (slot.tries == 0) {
+        // held back by the airtime budget before its first transmission
+        if (_transmit(slot)) {
+          _stats.packetsSent++;
+        }
+        continue;
+      }
+
+      if (now - slot.sentAtMs < _retransmitTimeoutMs) {
+        continue;
+      }
+
+      if (slot.tries > _maxRetries) {
+        _release(slot, false);
+        continue;
+      }
+
+      if (!slot.throttled) {
+        _recordTransmission(false); // the last transmission went unacked
+      }
+      if (_transmit(slot)) {
+        _stats.retransmissions++;
+      }
+    }
+  }
+
+protected:
+  void write_unbuffered(uint8_t const *buf, int size) final {
+    // use a free slot, or give up on the oldest packet
+    _Slot *slot = nullptr;
+    uint8_t oldestAge = 0;
+    for (uint8_t i = 0; i < WINDOW_SIZE; i++) {
+      _Slot &candidate = _window[i];
+      if (candidate.len == 0) {
+        slot = &candidate;
+        break;
+      }
+      uint8_t age = _txNextSeq - candidate.frame[1];
+      if (!candidate.held && age > oldestAge) {
+        slot = &candidate;
+        oldestAge = age;
+      }
+    }
+    if (slot == nullptr) {
+      // the window is full of received packets waiting to be delivered
+      _stats.packetsLost++;
+      return;
+    }
+    if (slot->len != 0) {
+      _release(*slot, false);
+    }
+
+    slot->held = false;
+    slot->throttled = false;
+    slot->frame[0] = RADIO_FRAME_DATA;
+    slot->frame[1] = _txNextSeq++;
+    slot->frame[3] = _txSession;
+    memcpy(slot->frame + RADIO_RELIABLE_HEADER_SIZE, buf, size);
+    slot->len = size + RADIO_RELIABLE_HEADER_SIZE;
+    slot->tries = 0;
+    if (_transmit(*slot)) {
+      _stats.packetsSent++;
+    }
+
+    poll(); // listen for ACKs
+  }
+
+public:
+  /**
+   * Create radio driver.
+   *
+   * Default parameters correspond to standard kit configuration.
+   *
+   * @param slaveSelectPin - Arduino digital pin connected to radio's NSS pin.
+   * @param interruptPin - Arduino digital pin with interrupt capabilities
+   * connected to radio's DIO0 pin.
+   * @param isRFM69HW - True if radio is a RFM69HW, false otherwise.
+   * @param spi - SPI interface where radio is connected. Use nullptr for
+   * default Arduino SPI interface.
+   */
+  ReliableRadio(uint8_t slaveSelectPin = RADIO_SS_PIN,
+                uint8_t interruptPin = RADIO_IRQ_PIN, bool isRFM69HW = false,
+                SPIClass *spi = nullptr)
+      : _Device(slaveSelectPin, interruptPin, isRFM69HW, spi) {}
+
+  /**
+   * Initialize radio device, forgetting unacknowledged packets and starting a
+   * new session (the receiver drops the packets it holds from us).
+   *
+   * Default parameters correspond to standard kit configuration.
+   *
+   * @param freqBand - Radio frequency band (see RFM69 library documentation).
+   * @returns True if initialization is successful, false otherwise.
+   */
+  bool begin(uint8_t freqBand = RF69_433MHZ) {
+    if (!_Device::begin(freqBand)) {
+      return false;
+    }
+#if CJKIT_VERSION != 0
+    _txPowerDBm = RADIO_DEFAULT_POWER_DBM;
+#endif
+
+    for (uint8_t i = 0; i < WINDOW_SIZE; i++) {
+      _window[i].len = 0;
+      _window[i].held = false;
+      _window[i].throttled = false;
+    }
+    _rxSynced = false;
+
+    // radio noise makes the session number differ after a restart, even if
+    // the kit takes just as long to get here
+    uint8_t session = (uint8_t)micros() ^ (uint8_t)this->_radio.readRSSI();
+    _txSession = session != _txSession ? session : session + 1;
+
+    return true;
+  }
+
+  /**
+   * Receive a packet, if one arrived.
+   *
+   * This also acknowledges received packets, processes received ACKs and
+   * retransmits unacknowledged packets (see [poll]). Packets are returned
+   * once, in the order they were sent.
+   *
+   * @param buf - Where to store the packet's payload (may be nullptr if
+   * bufSize is 0).
+   * @param bufSize - Size of buf. Longer payloads are truncated.
+   * @returns Size of the payload stored in buf, 0 if no packet was received.
+   */
+  uint8_t receive(uint8_t *buf, uint8_t bufSize) {
+    _retransmitExpired();
+
+    _Slot *held = _rxSkipMissing();
+    if (held != nullptr) {
+      uint8_t len = _deliver(buf, bufSize, held->frame, held->len);
+      held->len = 0;
+      held->held = false;
+      return len;
+    }
+
+    return _receiveFrame(buf, bufSize, true);
+  }
+
+  /**
+   * Process received ACKs and retransmit unacknowledged packets. Received
+   * data packets are held in the window until [receive] returns them (or left
+   * unacknowledged if the window is full).
+   *
+   * Should be called often by the sender (e.g. from CJKit::xdelay's idle
+   * task), and never takes longer than sending the retransmitted packets.
+   */
+  void poll(void) {
+    _retransmitExpired();
+    _receiveFrame(nullptr, 0, false);
+  }
+
+  /**
+   * Configure packet retransmission.
+   *
+   * @param timeoutMs - Time to wait for an ACK before retransmitting.
+   * @param maxRetries - Retransmissions before giving up on a packet.
+   */
+  void setRetransmission(unsigned long timeoutMs, uint8_t maxRetries) {
+    _retransmitTimeoutMs = timeoutMs;
+    _maxRetries = maxRetries;
+  }
+
+  /**
+   * Link statistics (see RadioLinkStats).
+   */
+  RadioLinkStats const &linkStats(void) const { return _stats; }
+
+#if CJKIT_VERSION != 0
+  /**
+   * Enable or disable transmit power adaptation.
+   *
+   * Transmit power is periodically raised when transmissions get lost or the
+   * receiver reports a weak signal, and lowered when the signal is stronger
+   * than needed, always staying between minDBm and maxDBm.
+   *
+   * @param enable - True to enable power adaptation.
+   * @param targetRssiDBm - Desired RSSI at the receiver.
+   * @param minDBm - Minimum transmit power.
+   * @param maxDBm - Maximum transmit power (by default the same as set by
+   * begin).
+   */
+  void setAdaptivePower(bool enable, int8_t targetRssiDBm = -80,
+                        int8_t minDBm = -2,
+                        int8_t maxDBm = RADIO_DEFAULT_POWER_DBM) {
+    _adaptivePower = enable;
+    _targetRssiDBm = targetRssiDBm;
+    _minPowerDBm = minDBm;
+    _maxPowerDBm = maxDBm;
+    _powerHoldCount = 0;
+
+    int8_t clamped = constrain(_txPowerDBm, minDBm, maxDBm);
+    if (enable && clamped != _txPowerDBm) {
+      _txPowerDBm = this->_radio.setPowerDBm(clamped);
+    }
+  }
+
+  /**
+   * Current transmit power in dBm.
+   */
+  int8_t txPowerDBm(void) const { return _txPowerDBm; }
+#endif
+};
+} // namespace CJKit
+
+#endif